@@ -14,7 +14,11 @@ LOCAL_SHARED_LIBRARIES := \
 LOCAL_SRC_FILES += 	sensors_module.c \
 			sensors_list.c \
 			sensors_config.c \
+			sensors_config_watch.c \
 			sensors_fifo.c \
+			sensors_stats.c \
+			sensors_trace.c \
+			sensors_lockprof.c \
 			sensors_worker.c \
 			sensors_select.c \
 			sensors_wrapper.c \
@@ -33,6 +37,12 @@ LOCAL_CFLAGS += -DLOG_NDEBUG
 # Set 1 to enable verbose debug
 LOCAL_CFLAGS += -DDEBUG_VERBOSE=0
 
+# Uncomment to write trace points to the ftrace trace_marker
+#LOCAL_CFLAGS += -DSENSORS_TRACE
+
+# Uncomment to profile lock contention, dumped with the statistics
+#LOCAL_CFLAGS += -DSENSORS_LOCK_PROF
+
 include $(LOCAL_PATH)/sensors/Sensors.mk
 LOCAL_SRC_FILES += $(patsubst %,sensors/%, $(yes-files))
 LOCAL_CFLAGS += $(yes-cflags)
@@ -48,5 +58,18 @@ endif
 LOCAL_MODULE_TAGS := optional
 include $(BUILD_SHARED_LIBRARY)
 
+# Host tool compiling dash.conf into the binary image loaded from
+# /etc/dash.conf.bin
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := sensors_config.c \
+		   sensors_config_compiler.c
+LOCAL_STATIC_LIBRARIES := liblog
+LOCAL_LDLIBS += -lpthread
+LOCAL_CFLAGS += -DLOG_NDEBUG
+LOCAL_MODULE := dash_config_compiler
+LOCAL_MODULE_TAGS := optional
+include $(BUILD_HOST_EXECUTABLE)
+
 include $(call first-makefiles-under, $(LOCAL_PATH)/libs)
 
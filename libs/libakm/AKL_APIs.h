@@ -161,6 +161,19 @@ int16_t AKL_SetVector(
     const uint8_t                num
 );
 
+/*!
+ * Same as #AKL_SetVector, but takes floating point data.
+ * \return #AKM_SUCCESS Succeeded.
+ * \param mem A pointer to data buffer which size should be equal to the return
+ * value of #AKL_GetParameterSize.
+ * \param data A pointer to #AKM_SENSOR_DATA_F struct (or array).
+ * \param num A number of data to be input.
+ */
+int16_t AKL_SetVectorF(
+    struct AKL_SCL_PRMS            *mem,
+    const struct AKM_SENSOR_DATA_F *data,
+    const uint8_t                  num
+);
 
 /*!
  * Calculate.
@@ -191,6 +204,18 @@ int16_t AKL_GetVector(
     int32_t               *status
 );
 
+/*!
+ * Same as #AKL_GetVector, but returns floating point data in the units
+ * of #AKM_SENSOR_DATA_F.
+ */
+int16_t AKL_GetVectorF(
+    const AKM_VECTOR_TYPE vtype,
+    struct AKL_SCL_PRMS   *mem,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status
+);
+
 /*!
  * Get library version information.
  * \return #AKM_SUCCESS Succeeded.
@@ -18,10 +18,104 @@
 #ifndef __AKL_DASH_EXT_H__
 #define __AKL_DASH_EXT_H__
 
+#include <stddef.h>
 #include "AKL_APIs.h"
 
 #define AKL_DRV_PATH_LEN  64
 
+/*!
+ * One AKM library instance with its own memory, lock and published
+ * snapshot. Several instances may run side by side, e.g. one per
+ * magnetometer or one per calibration configuration under evaluation.
+ */
+struct AKL_DASH_CTX;
+
+/*!
+ * Bytes needed for an instance created from a caller-supplied arena.
+ */
+size_t AKL_DASH_GetContextSize(
+    const uint8_t max_form
+);
+
+/*!
+ * Create an instance. \a arena must be 8-byte aligned and hold at least
+ * #AKL_DASH_GetContextSize bytes; pass NULL to allocate from the heap.
+ * Returns NULL on failure. The library itself is not initialized.
+ */
+struct AKL_DASH_CTX *AKL_DASH_Create(
+    const uint8_t max_form,
+    void          *arena,
+    size_t        size
+);
+
+/*!
+ * Stop the instance and release it. An arena is left to its owner.
+ */
+void AKL_DASH_Destroy(
+    struct AKL_DASH_CTX *ctx
+);
+
+struct AKL_SCL_PRMS *AKL_DASH_CtxLock(
+    struct AKL_DASH_CTX *ctx
+);
+
+/*!
+ * Same as #AKL_DASH_CtxLock, but returns NULL at once when the lock
+ * is held elsewhere.
+ */
+struct AKL_SCL_PRMS *AKL_DASH_CtxTryLock(
+    struct AKL_DASH_CTX *ctx
+);
+
+void AKL_DASH_CtxUnlock(
+    struct AKL_DASH_CTX *ctx
+);
+
+/*!
+ * Per-instance #AKL_DASH_Publish, called with #AKL_DASH_CtxLock held.
+ */
+void AKL_DASH_CtxPublish(
+    struct AKL_DASH_CTX *ctx,
+    const uint32_t      vtypes
+);
+
+/*!
+ * Per-instance #AKL_DASH_GetVector, lock free.
+ */
+int16_t AKL_DASH_CtxGetVector(
+    struct AKL_DASH_CTX   *ctx,
+    const AKM_VECTOR_TYPE vtype,
+    int32_t               *data,
+    uint8_t               size,
+    int32_t               *status
+);
+
+/*!
+ * Per-instance #AKL_DASH_GetVectorF, lock free.
+ */
+int16_t AKL_DASH_CtxGetVectorF(
+    struct AKL_DASH_CTX   *ctx,
+    const AKM_VECTOR_TYPE vtype,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status
+);
+
+/*!
+ * Tell whether NV data returned by #AKL_StopMeasurement differs enough
+ * from the copy last written to storage to be worth writing again.
+ */
+int AKL_DASH_NVChanged(
+    const uint8_t  *saved,
+    const uint8_t  *nv_data,
+    const uint16_t size
+);
+
+/*
+ * The functions below work on a default instance shared by all modules.
+ * Init and Deinit are counted, the last Deinit destroys the instance.
+ */
+
 int AKL_DASH_Init(
     const uint8_t max_form
 );
@@ -34,7 +128,76 @@ struct AKL_SCL_PRMS *AKL_DASH_Lock(
     void
 );
 
+struct AKL_SCL_PRMS *AKL_DASH_TryLock(
+    void
+);
+
 void AKL_DASH_Unlock(
     void
 );
+
+#ifdef SENSORS_LOCK_PROF
+/*
+ * In the HAL built with the lock profiler the default instance lock is
+ * profiled at each call site, like the HAL's own mutexes.
+ */
+#include "sensors_lockprof.h"
+
+static inline struct AKL_SCL_PRMS *AKL_DASH_ProfLock(
+    const char *file,
+    int        line)
+{
+    int64_t             t = sensors_lockprof_now();
+    struct AKL_SCL_PRMS *mem = AKL_DASH_TryLock();
+    int                 contended = (NULL == mem);
+
+    if (contended) {
+        mem = AKL_DASH_Lock();
+    }
+
+    sensors_lockprof_acquired(&AKL_DASH_Lock, "akl", file, line,
+                              t, contended);
+    return mem;
+}
+
+static inline void AKL_DASH_ProfUnlock(void)
+{
+    sensors_lockprof_released(&AKL_DASH_Lock);
+    AKL_DASH_Unlock();
+}
+
+#define AKL_DASH_Lock()    AKL_DASH_ProfLock(__FILE__, __LINE__)
+#define AKL_DASH_Unlock()  AKL_DASH_ProfUnlock()
+#endif
+
+/*!
+ * Copy the given output vectors (a mask of #AKM_VECTOR_TYPE) to the
+ * published snapshot. Must be called with #AKL_DASH_Lock held.
+ */
+void AKL_DASH_Publish(
+    struct AKL_SCL_PRMS *mem,
+    const uint32_t      vtypes
+);
+
+/*!
+ * Read a published vector without taking the lock. Same arguments and
+ * return values as #AKL_GetVector, minus the memory handle.
+ */
+int16_t AKL_DASH_GetVector(
+    const AKM_VECTOR_TYPE vtype,
+    int32_t               *data,
+    uint8_t               size,
+    int32_t               *status
+);
+
+/*!
+ * Same as #AKL_DASH_GetVector, in the floating point units of
+ * #AKL_GetVectorF. The snapshot is kept in this form.
+ */
+int16_t AKL_DASH_GetVectorF(
+    const AKM_VECTOR_TYPE vtype,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status
+);
 #endif /* __AKL_DASH_EXT_H__ */
@@ -83,6 +83,8 @@ typedef enum {
 #define AKM_VT_LACC_SIZE     3
 /*! data[0,1,2,3] = (x,y,z,w). */
 #define AKM_VT_QUAT_SIZE     4
+/*! data[0,1,2,3] = (x,y,z,w). */
+#define AKM_VT_GEOQUAT_SIZE  4
 /*@}*/
 
 /*! Type of vector. When get this type of vector,
@@ -117,6 +119,10 @@ typedef enum {
     /*! Quaternion.\n
      * A data is stored in the vector in order of x, y, z, and w. */
     AKM_VT_QUAT = 0x40,
+    /*! Geomagnetic quaternion.\n
+     * The same format as #AKM_VT_QUAT, from the accelerometer and
+     * magnetometer only, also when the gyroscope is fused. */
+    AKM_VT_GEOQUAT = 0x80,
 } AKM_VECTOR_TYPE;
 
 /*!
@@ -165,4 +171,25 @@ struct AKM_SENSOR_DATA {
      * this data was acquired.*/
     AKM_SENSOR_TYPE stype;
 };
+
+/*!
+ * Floating point counterpart of #AKM_SENSOR_DATA. The units are the same
+ * without the Q16 scaling, i.e. micro Tesla, m/s^2 and degree/second.
+ */
+struct AKM_SENSOR_DATA_F {
+    union {
+        struct {
+            float x;
+            float y;
+            float z;
+        } s;
+        float v[3];
+    } u;
+    /*! Time stamp in micro seconds, see #AKM_SENSOR_DATA. */
+    uint32_t        time_us;
+    /*! Device status register value, see #AKM_SENSOR_DATA. */
+    int16_t         status[2];
+    /*! Sensor type of this data. */
+    AKM_SENSOR_TYPE stype;
+};
 #endif /* __AKM_COMMON_H__ */
@@ -28,8 +28,11 @@ LOCAL_SRC_FILES := common/akl_dash_ext.c
 LOCAL_LDFLAGS := -Wl,--version-script,$(LOCAL_PATH)/common/akl_apis.map
 
 LOCAL_SRC_FILES += $(SCL_LIB_DIR)/akfs_aoc.c \
+				   $(SCL_LIB_DIR)/akfs_calib.c \
 				   $(SCL_LIB_DIR)/akfs_device.c \
 				   $(SCL_LIB_DIR)/akfs_direction.c \
+				   $(SCL_LIB_DIR)/akfs_ellipsoid.c \
+				   $(SCL_LIB_DIR)/akfs_fusion.c \
 				   $(SCL_LIB_DIR)/akfs_measure.c \
 				   $(SCL_LIB_DIR)/akfs_vnorm.c \
 				   $(SCL_LIB_DIR)/akl_apis.c
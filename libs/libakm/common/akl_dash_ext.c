@@ -17,9 +17,15 @@
  ******************************************************************************/
 #define LOG_TAG  "AKL - dash_ext"
 
+/* the lock profiler wraps the callers of this file, not the file itself */
+#undef SENSORS_LOCK_PROF
+
 #include <cutils/log.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "AKL_APIs.h"
@@ -34,41 +40,319 @@
 #include "libpg/akl_smart_compass.h"
 #elif defined(AKMOSS)
 #include "oss/akfs_compass.h"
+#include "oss/akfs_measure.h"
 #else
 #error No library defined.
 #endif
 
 #define INFO_DATA_LEN  7
 
+/* one slot per bit of AKM_VECTOR_TYPE, the largest vector has 6 elements */
+#define SNAP_SLOTS     8
+#define SNAP_SIZE      6
+
+/* Seqlock: the writer makes seq odd while it updates the slot, readers
+ * retry until they see the same even seq before and after their copy. */
+struct akl_dash_snap {
+    uint32_t seq;
+    int16_t  ret;
+    int32_t  status;
+    float    data[SNAP_SIZE];
+};
+
+static const uint8_t        snap_size[SNAP_SLOTS] = {
+    AKM_VT_MAG_SIZE,
+    AKM_VT_ACC_SIZE,
+    AKM_VT_GYR_SIZE,
+    AKM_VT_ORI_SIZE,
+    AKM_VT_GRAVITY_SIZE,
+    AKM_VT_LACC_SIZE,
+    AKM_VT_QUAT_SIZE,
+    AKM_VT_GEOQUAT_SIZE,
+};
+
+/* One library instance: its memory, the lock that serializes it and
+ * the snapshot readers use. The memory follows the context in one block. */
+struct AKL_DASH_CTX {
+    pthread_mutex_t      lock;
+    struct akl_dash_snap snap[SNAP_SLOTS];
+    struct AKL_SCL_PRMS  *mem;
+    int                  owned;
+};
+
+/* smallest offset move, in uT, that is worth writing back to NV */
+#define NV_OFFSET_DELTA  0.5f
+
+#define CTX_ALIGN(sz)  (((sz) + 7) & ~(size_t)7)
+
 /* AKM library may be called from many modules. */
-/* Therefore save memory handle */
-static struct AKL_SCL_PRMS *handle = NULL;
-static pthread_mutex_t     akl_mutex;
+/* Therefore keep a default instance for the legacy entry points */
+static struct AKL_DASH_CTX *def_ctx = NULL;
+static int                 def_users = 0;
 
-int AKL_DASH_Init(const uint8_t max_form)
+static int snap_slot(const uint32_t vtype)
 {
-    uint16_t sz;
+    int i;
 
-    ALOGI("%s: called.", __func__);
+    for (i = 0; i < SNAP_SLOTS; i++) {
+        if (vtype == (1u << i)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+size_t AKL_DASH_GetContextSize(const uint8_t max_form)
+{
+    /* AKL_Init places the NV parameters right after the scl parameters */
+    return CTX_ALIGN(sizeof(struct AKL_DASH_CTX))
+           + AKL_GetParameterSize(max_form)
+           + AKL_GetNVdataSize(max_form);
+}
+
+struct AKL_DASH_CTX *AKL_DASH_Create(
+    const uint8_t max_form,
+    void          *arena,
+    size_t        size)
+{
+    struct AKL_DASH_CTX *ctx;
+    size_t              sz;
+    int                 owned = 0;
+    int                 i;
+
+    sz = AKL_DASH_GetContextSize(max_form);
+    ALOGI("%s: sz=%zu", __func__, sz);
 
-    if (NULL == handle) {
-        sz = AKL_GetParameterSize(max_form);
-        ALOGI("%s: sz=%d", __func__, sz);
-        handle = malloc(sz);
+    if (NULL == arena) {
+        arena = malloc(sz);
 
-        if (NULL == handle) {
+        if (NULL == arena) {
             ALOGE("%s: malloc failed", __func__);
-            return AKM_ERROR;
+            return NULL;
+        }
+
+        owned = 1;
+    } else if ((size < sz) || ((uintptr_t)arena & 7)) {
+        ALOGE("%s: arena too small or misaligned", __func__);
+        return NULL;
+    }
+
+    ctx = arena;
+    memset(ctx, 0, sz);
+    ctx->mem = (struct AKL_SCL_PRMS *)(
+            (uint8_t *)arena + CTX_ALIGN(sizeof(struct AKL_DASH_CTX)));
+    ctx->owned = owned;
+
+    /* init mutex */
+    if (pthread_mutex_init(&ctx->lock, NULL)) {
+        if (ctx->owned) {
+            free(ctx);
+        }
+
+        return NULL;
+    }
+
+    /* nothing published yet */
+    for (i = 0; i < SNAP_SLOTS; i++) {
+        ctx->snap[i].ret = AKM_ERR_BUSY;
+    }
+
+    return ctx;
+}
+
+void AKL_DASH_Destroy(struct AKL_DASH_CTX *ctx)
+{
+    if (NULL == ctx) {
+        return;
+    }
+
+#if defined(AKMOSS)
+    /* the calibration thread must not outlive its memory */
+    AKL_StopMeasurement(ctx->mem, NULL);
+#endif
+    /* deinit mutex */
+    pthread_mutex_destroy(&ctx->lock);
+
+    if (ctx->owned) {
+        free(ctx);
+    }
+}
+
+struct AKL_SCL_PRMS *AKL_DASH_CtxLock(struct AKL_DASH_CTX *ctx)
+{
+    pthread_mutex_lock(&ctx->lock);
+    return ctx->mem;
+}
+
+struct AKL_SCL_PRMS *AKL_DASH_CtxTryLock(struct AKL_DASH_CTX *ctx)
+{
+    return pthread_mutex_trylock(&ctx->lock) ? NULL : ctx->mem;
+}
+
+void AKL_DASH_CtxUnlock(struct AKL_DASH_CTX *ctx)
+{
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+void AKL_DASH_CtxPublish(
+    struct AKL_DASH_CTX *ctx,
+    const uint32_t      vtypes)
+{
+    struct akl_dash_snap *p;
+    float                data[SNAP_SIZE];
+    int32_t              status = 0;
+    int16_t              ret;
+    int                  i, j;
+
+    for (i = 0; i < SNAP_SLOTS; i++) {
+        if (!(vtypes & (1u << i))) {
+            continue;
+        }
+
+        /* compute outside the write section, readers only retry on copy */
+        memset(data, 0, sizeof(data));
+        ret = AKL_GetVectorF((AKM_VECTOR_TYPE)(1u << i), ctx->mem, data,
+                             SNAP_SIZE, &status);
+
+        p = &ctx->snap[i];
+        __atomic_store_n(&p->seq, p->seq + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        __atomic_store_n(&p->ret, ret, __ATOMIC_RELAXED);
+        __atomic_store_n(&p->status, status, __ATOMIC_RELAXED);
+
+        for (j = 0; j < SNAP_SIZE; j++) {
+            __atomic_store(&p->data[j], &data[j], __ATOMIC_RELAXED);
+        }
+
+        __atomic_store_n(&p->seq, p->seq + 1, __ATOMIC_RELEASE);
+    }
+}
+
+int16_t AKL_DASH_CtxGetVectorF(
+    struct AKL_DASH_CTX   *ctx,
+    const AKM_VECTOR_TYPE vtype,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    struct akl_dash_snap *p;
+    uint32_t             seq;
+    int16_t              ret;
+    int                  slot;
+    int                  i;
+
+    slot = snap_slot((uint32_t)vtype);
+
+    if (slot < 0) {
+        return AKM_ERR_NOT_SUPPORT;
+    }
+
+    if (snap_size[slot] > size) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    size = snap_size[slot];
+    p = &ctx->snap[slot];
+
+    do {
+        seq = __atomic_load_n(&p->seq, __ATOMIC_ACQUIRE);
+
+        if (seq & 1) {
+            continue;
+        }
+
+        ret = __atomic_load_n(&p->ret, __ATOMIC_RELAXED);
+        *status = __atomic_load_n(&p->status, __ATOMIC_RELAXED);
+
+        for (i = 0; i < size; i++) {
+            __atomic_load(&p->data[i], &data[i], __ATOMIC_RELAXED);
         }
 
-        /* init mutex */
-        if (pthread_mutex_init(&akl_mutex, NULL)) {
-            free(handle);
-            handle = NULL;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) ||
+             (seq != __atomic_load_n(&p->seq, __ATOMIC_RELAXED)));
+
+    return ret;
+}
+
+int16_t AKL_DASH_CtxGetVector(
+    struct AKL_DASH_CTX   *ctx,
+    const AKM_VECTOR_TYPE vtype,
+    int32_t               *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    float   v[SNAP_SIZE];
+    int16_t ret;
+    int     i;
+
+    ret = AKL_DASH_CtxGetVectorF(ctx, vtype, v, size, status);
+
+    if (ret != AKM_SUCCESS) {
+        return ret;
+    }
+
+    /* only the vector itself is written */
+    for (i = 0; i < snap_size[snap_slot((uint32_t)vtype)]; i++) {
+        data[i] = (int32_t)(v[i] * 65536);
+    }
+
+    return AKM_SUCCESS;
+}
+
+int AKL_DASH_NVChanged(
+    const uint8_t  *saved,
+    const uint8_t  *nv_data,
+    const uint16_t size)
+{
+#if defined(AKMOSS)
+    const struct AKL_NV_PRMS *p_sv = (const struct AKL_NV_PRMS *)saved;
+    const struct AKL_NV_PRMS *p_nv = (const struct AKL_NV_PRMS *)nv_data;
+    AKFLOAT                  d;
+    int                      i;
+
+    /* a new accuracy is worth keeping for the next warm start */
+    if ((p_sv->magic != p_nv->magic) ||
+        (p_sv->i16_hsuc_status != p_nv->i16_hsuc_status)) {
+        return 1;
+    }
+
+    /* a confirmed accuracy refreshes its time before the warm start decays */
+    if ((p_nv->i16_hsuc_status > 0) &&
+        (p_nv->u32_hsuc_time - p_sv->u32_hsuc_time > AKFS_WARM_FRESH)) {
+        return 1;
+    }
+
+    for (i = 0; i < 3; i++) {
+        d = p_nv->fv_hsuc_ho.v[i] - p_sv->fv_hsuc_ho.v[i];
+
+        if ((d > NV_OFFSET_DELTA) || (d < -NV_OFFSET_DELTA)) {
+            return 1;
+        }
+    }
+
+    return 0;
+#else
+    /* the layout is private to the library, any change counts */
+    return memcmp(saved, nv_data, size) != 0;
+#endif
+}
+
+int AKL_DASH_Init(const uint8_t max_form)
+{
+    ALOGI("%s: called.", __func__);
+
+    if (NULL == def_ctx) {
+        def_ctx = AKL_DASH_Create(max_form, NULL, 0);
+
+        if (NULL == def_ctx) {
             return AKM_ERROR;
         }
     }
 
+    def_users++;
     return AKM_SUCCESS;
 }
 
@@ -76,21 +360,51 @@ void AKL_DASH_Deinit(void)
 {
     ALOGI("%s: called.", __func__);
 
-    if (NULL != handle) {
-        free(handle);
-        handle = NULL;
-        /* deinit mutex */
-        pthread_mutex_destroy(&akl_mutex);
+    /* only the last user tears the default instance down */
+    if ((NULL != def_ctx) && (--def_users <= 0)) {
+        AKL_DASH_Destroy(def_ctx);
+        def_ctx = NULL;
+        def_users = 0;
     }
 }
 
 struct AKL_SCL_PRMS *AKL_DASH_Lock(void)
 {
-    pthread_mutex_lock(&akl_mutex);
-    return handle;
+    return AKL_DASH_CtxLock(def_ctx);
+}
+
+struct AKL_SCL_PRMS *AKL_DASH_TryLock(void)
+{
+    return AKL_DASH_CtxTryLock(def_ctx);
 }
 
 void AKL_DASH_Unlock(void)
 {
-    pthread_mutex_unlock(&akl_mutex);
+    AKL_DASH_CtxUnlock(def_ctx);
+}
+
+void AKL_DASH_Publish(
+    struct AKL_SCL_PRMS *mem,
+    const uint32_t      vtypes)
+{
+    (void)mem;
+    AKL_DASH_CtxPublish(def_ctx, vtypes);
+}
+
+int16_t AKL_DASH_GetVector(
+    const AKM_VECTOR_TYPE vtype,
+    int32_t               *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    return AKL_DASH_CtxGetVector(def_ctx, vtype, data, size, status);
+}
+
+int16_t AKL_DASH_GetVectorF(
+    const AKM_VECTOR_TYPE vtype,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    return AKL_DASH_CtxGetVectorF(def_ctx, vtype, data, size, status);
 }
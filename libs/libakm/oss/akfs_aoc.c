@@ -163,12 +163,15 @@ static void Get4points(
     AKFLOAT temp;
     AKFLOAT d;
 
-    AKFVEC dv[AKFS_HBUF_SIZE];
+    AKFVEC dv[AKFS_HEXT_SIZE + 1];
     AKFVEC cross = {{0, 0, 0}};
     AKFVEC tempv = {{0, 0, 0}};
 
-    /* out 0 */
+    /* out 0, degenerate input leaves all points equal */
     out[0] = v[0];
+    out[1] = v[0];
+    out[2] = v[0];
+    out[3] = v[0];
 
     /* out 1 */
     d = 0.0;
@@ -225,20 +228,41 @@ static void Get4points(
 }
 
 /*
- * CheckInitFvec
+ * ExtPush
  */
-static int16_t CheckInitFvec(const AKFVEC *v /*!< [in]	vector */
+static void ExtPush(
+    AKFS_AOC_EXT       *ext,   /*!< (i/o) : queue of one axis extreme */
+    const AKFS_AOC_VAR *haocv, /*!< (i)   : a set of variables */
+    const int16_t      axis,   /*!< (i)   : axis */
+    const int16_t      sign    /*!< (i)   : 1 for maximum, -1 for minimum */
 )
 {
-    int16_t i;
+    uint32_t newest = haocv->hseq - 1;
+    AKFLOAT  val = sign * haocv->hbuf[newest % AKFS_HBUF_SIZE].v[axis];
+    int16_t  back;
+
+    /* drop samples that left the window, the queue is in sample order */
+    while ((ext->num > 0) &&
+           ((uint32_t)(newest - ext->seq[ext->head]) >=
+            (uint32_t)haocv->hnum)) {
+        ext->head = (ext->head + 1) % AKFS_HBUF_SIZE;
+        ext->num--;
+    }
 
-    for (i = 0; i < 3; i++) {
-        if (AKFS_FMAX <= v->v[i]) {
-            return 1; /* initvalue */
+    /* older samples that are not more extreme can never be the front */
+    while (ext->num > 0) {
+        back = (ext->head + ext->num - 1) % AKFS_HBUF_SIZE;
+
+        if (sign * haocv->hbuf[ext->seq[back] % AKFS_HBUF_SIZE].v[axis] >
+            val) {
+            break;
         }
+
+        ext->num--;
     }
 
-    return 0; /* not initvalue */
+    ext->seq[(ext->head + ext->num) % AKFS_HBUF_SIZE] = newest;
+    ext->num++;
 }
 
 /*
@@ -252,38 +276,44 @@ int16_t AKFS_AOC(
 )
 {
     int16_t i, j;
-    int16_t num;
     AKFLOAT tempf;
     AKFVEC  tempho;
 
     AKFVEC fourpoints[4];
+    AKFVEC candidates[AKFS_HEXT_SIZE + 1];
 
     AKFVEC var;
     AKFVEC mean;
 
     /* buffer new data */
-    for (i = 1; i < AKFS_HBUF_SIZE; i++) {
-        haocv->hbuf[AKFS_HBUF_SIZE - i] = haocv->hbuf[AKFS_HBUF_SIZE - i - 1];
-    }
+    haocv->hbuf[haocv->hseq % AKFS_HBUF_SIZE] = *hdata;
+    haocv->hseq++;
 
-    haocv->hbuf[0] = *hdata;
-
-    /* Check Init */
-    num = 0;
+    if (haocv->hnum < AKFS_HBUF_SIZE) {
+        haocv->hnum++;
+    }
 
-    for (i = AKFS_HBUF_SIZE; 3 < i; i--) {
-        if (CheckInitFvec(&haocv->hbuf[i - 1]) == 0) {
-            num = i;
-            break;
-        }
+    for (i = 0; i < AKFS_HEXT_SIZE; i++) {
+        ExtPush(&haocv->hext[i], haocv, i >> 1, (i & 1) ? -1 : 1);
     }
 
-    if (num < 4) {
+    if (haocv->hnum < 4) {
         return AKFS_ERROR;
     }
 
-    /* get 4 points */
-    Get4points(haocv->hbuf, num, fourpoints);
+    /*
+     * get 4 points: the newest sample and the window extremes per axis
+     * are the candidates, so the cost does not grow with AKFS_HBUF_SIZE
+     */
+    candidates[0] = *hdata;
+
+    for (i = 0; i < AKFS_HEXT_SIZE; i++) {
+        j = haocv->hext[i].head;
+        candidates[i + 1] =
+            haocv->hbuf[haocv->hext[i].seq[j] % AKFS_HBUF_SIZE];
+    }
+
+    Get4points(candidates, AKFS_HEXT_SIZE + 1, fourpoints);
 
     /* estimate offset */
     if (0 != From4Points2Sphere(fourpoints, &tempho, &haocv->hraoc)) {
@@ -302,22 +332,20 @@ int16_t AKFS_AOC(
     }
 
     /* update offset buffer */
-    for (i = 1; i < AKFS_HOBUF_SIZE; i++) {
-        haocv->hobuf[AKFS_HOBUF_SIZE -
-                     i] = haocv->hobuf[AKFS_HOBUF_SIZE - i - 1];
-    }
+    haocv->hobuf[haocv->hohead] = tempho;
+    haocv->hohead = (haocv->hohead + 1) % AKFS_HOBUF_SIZE;
 
-    haocv->hobuf[0] = tempho;
+    if (haocv->honum < AKFS_HOBUF_SIZE) {
+        haocv->honum++;
+    }
 
-    /* clear hbuf */
-    for (i = (AKFS_HBUF_SIZE >> 1); i < AKFS_HBUF_SIZE; i++) {
-        for (j = 0; j < 3; j++) {
-            haocv->hbuf[i].v[j] = AKFS_FMAX;
-        }
+    /* clear hbuf, keep the newer half */
+    if (haocv->hnum > (AKFS_HBUF_SIZE >> 1)) {
+        haocv->hnum = (AKFS_HBUF_SIZE >> 1);
     }
 
     /* Check Init */
-    if (CheckInitFvec(&haocv->hobuf[AKFS_HOBUF_SIZE - 1]) == 1) {
+    if (haocv->honum < AKFS_HOBUF_SIZE) {
         return AKFS_ERROR;
     }
 
@@ -339,19 +367,17 @@ int16_t AKFS_AOC(
  */
 void AKFS_InitAOC(AKFS_AOC_VAR *haocv)
 {
-    int16_t i, j;
+    int16_t i;
 
     /* Initialize buffer */
-    for (i = 0; i < AKFS_HBUF_SIZE; i++) {
-        for (j = 0; j < 3; j++) {
-            haocv->hbuf[i].v[j] = AKFS_FMAX;
-        }
-    }
-
-    for (i = 0; i < AKFS_HOBUF_SIZE; i++) {
-        for (j = 0; j < 3; j++) {
-            haocv->hobuf[i].v[j] = AKFS_FMAX;
-        }
+    haocv->hseq = 0;
+    haocv->hnum = 0;
+    haocv->hohead = 0;
+    haocv->honum = 0;
+
+    for (i = 0; i < AKFS_HEXT_SIZE; i++) {
+        haocv->hext[i].head = 0;
+        haocv->hext[i].num = 0;
     }
 
     haocv->hraoc = 0.0;
@@ -21,18 +21,31 @@
 #include "akfs_device.h"
 
 /***** Constant definition ****************************************************/
-#define AKFS_HBUF_SIZE   20
+#define AKFS_HBUF_SIZE   32 /* power of two, indexed by sample number */
 #define AKFS_HOBUF_SIZE  4
+#define AKFS_HEXT_SIZE   6  /* minimum and maximum per axis */
 #define AKFS_HR_TH       10
 #define AKFS_HO_TH       0.15
 
 /***** Macro definition *******************************************************/
 
 /***** Type declaration *******************************************************/
+/* monotonic queue of sample numbers, the front is the window extreme */
+typedef struct _AKFS_AOC_EXT {
+    uint32_t seq[AKFS_HBUF_SIZE];
+    int16_t  head;
+    int16_t  num;
+} AKFS_AOC_EXT;
+
 typedef struct _AKFS_AOC_VAR {
-    AKFVEC  hbuf[AKFS_HBUF_SIZE];
-    AKFVEC  hobuf[AKFS_HOBUF_SIZE];
-    AKFLOAT hraoc;
+    AKFVEC       hbuf[AKFS_HBUF_SIZE];
+    AKFVEC       hobuf[AKFS_HOBUF_SIZE];
+    AKFS_AOC_EXT hext[AKFS_HEXT_SIZE];
+    uint32_t     hseq;   /* number of the next sample */
+    int16_t      hnum;   /* valid samples in hbuf, newest first */
+    int16_t      hohead;
+    int16_t      honum;
+    AKFLOAT      hraoc;
 } AKFS_AOC_VAR;
 
 /***** Prototype of function **************************************************/
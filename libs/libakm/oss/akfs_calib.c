@@ -0,0 +1,269 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#include <sys/resource.h>
+#include "akfs_calib.h"
+#include "akfs_math.h"
+
+/*
+ * Solve
+ */
+static int16_t Solve(
+                           /*!< (o) : new offset(AKFS_SUCCESS), none(AKFS_ERROR) */
+    AKFS_CALIB_VAR *hcalv, /*!< (i/o) : solver state */
+    const AKFVEC   *hdata  /*!< (i)   : one candidate */
+)
+{
+    if (hcalv->hcalib == AKFS_HCALIB_ELLIPSOID) {
+        return AKFS_Ellipsoid(&hcalv->ellv, hdata, hcalv->sense,
+                              &hcalv->wo, &hcalv->ws);
+    }
+
+    return AKFS_AOC(&hcalv->aocv, hdata, &hcalv->wo);
+}
+
+/*
+ * Novel
+ */
+static int16_t Novel(
+                           /*!< (o) : admit(AKFS_SUCCESS), drop(AKFS_ERROR) */
+    AKFS_CALIB_VAR *hcalv, /*!< (i/o) : gate state */
+    const AKFVEC   *hdata, /*!< (i)   : raw vector */
+    const AKFVEC   *ho     /*!< (i)   : current offset */
+)
+{
+    AKFVEC  d;
+    AKFLOAT n2, dot, r;
+    int16_t i, n;
+
+    d.u.x = hdata->u.x - ho->u.x;
+    d.u.y = hdata->u.y - ho->u.y;
+    d.u.z = hdata->u.z - ho->u.z;
+    n2 = d.u.x * d.u.x + d.u.y * d.u.y + d.u.z * d.u.z;
+
+    if (n2 <= AKFS_EPSILON) {
+        return AKFS_ERROR;
+    }
+
+    /* cos^2 of the angle to each recent direction, no sqrt on a drop */
+    n = (hcalv->ngate < AKFS_GATE_SIZE) ? hcalv->ngate : AKFS_GATE_SIZE;
+
+    for (i = 0; i < n; i++) {
+        dot = d.u.x * hcalv->gate[i].u.x + d.u.y * hcalv->gate[i].u.y
+            + d.u.z * hcalv->gate[i].u.z;
+
+        if ((dot > 0) && (dot * dot >= hcalv->gcos2 * n2)) {
+            return AKFS_ERROR;
+        }
+    }
+
+    r = 1 / AKFS_SQRT(n2);
+    i = hcalv->ngate % AKFS_GATE_SIZE;
+    hcalv->gate[i].u.x = d.u.x * r;
+    hcalv->gate[i].u.y = d.u.y * r;
+    hcalv->gate[i].u.z = d.u.z * r;
+    hcalv->ngate++;
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * CalibThread
+ */
+static void *CalibThread(void *arg)
+{
+    AKFS_CALIB_VAR *hcalv = arg;
+    AKFVEC         batch[AKFS_CAND_SIZE];
+    uint32_t       n, i;
+    int16_t        found;
+
+    /* on Linux this only lowers the calling thread */
+    setpriority(PRIO_PROCESS, 0, AKFS_CALIB_NICE);
+
+    pthread_mutex_lock(&hcalv->lock);
+
+    while (hcalv->running) {
+        if (hcalv->head == hcalv->tail) {
+            pthread_cond_wait(&hcalv->cond, &hcalv->lock);
+            continue;
+        }
+
+        n = 0;
+
+        while (hcalv->tail != hcalv->head) {
+            batch[n++] = hcalv->cand[hcalv->tail % AKFS_CAND_SIZE];
+            hcalv->tail++;
+        }
+
+        pthread_mutex_unlock(&hcalv->lock);
+
+        found = 0;
+
+        for (i = 0; i < n; i++) {
+            if (Solve(hcalv, &batch[i]) == AKFS_SUCCESS) {
+                found = 1;
+            }
+        }
+
+        pthread_mutex_lock(&hcalv->lock);
+
+        if (found) {
+            hcalv->ho = hcalv->wo;
+            hcalv->hs = hcalv->ws;
+            hcalv->gen++;
+        }
+    }
+
+    pthread_mutex_unlock(&hcalv->lock);
+
+    return NULL;
+}
+
+/*
+ * AKFS_InitCalib
+ */
+void AKFS_InitCalib(AKFS_CALIB_VAR *hcalv)
+{
+    hcalv->running = 0;
+}
+
+/*
+ * AKFS_StartCalib
+ */
+int16_t AKFS_StartCalib(
+                           /*!< (o) : thread started(AKFS_SUCCESS), failure(AKFS_ERROR) */
+    AKFS_CALIB_VAR *hcalv, /*!< (i/o) : solver state */
+    const int16_t  hcalib, /*!< (i)   : calibration engine */
+    const AKFLOAT  angle,  /*!< (i)   : novelty gate, degree */
+    const AKFLOAT  sense,  /*!< (i)   : nominal sensitivity */
+    const AKFVEC   *ho,    /*!< (i)   : initial offset */
+    const AKFVEC   *hs     /*!< (i)   : initial sensitivity */
+)
+{
+    AKFS_StopCalib(hcalv);
+
+    AKFS_InitAOC(&hcalv->aocv);
+    AKFS_InitEllipsoid(&hcalv->ellv);
+    hcalv->hcalib = hcalib;
+    hcalv->sense = sense;
+    hcalv->wo = *ho;
+    hcalv->ws = *hs;
+    hcalv->ho = *ho;
+    hcalv->hs = *hs;
+    hcalv->head = 0;
+    hcalv->tail = 0;
+    hcalv->gen = 0;
+    hcalv->ngate = 0;
+    hcalv->gcos2 = AKFS_COS(DEG2RAD(angle)) * AKFS_COS(DEG2RAD(angle));
+    hcalv->running = 1;
+
+    if (pthread_mutex_init(&hcalv->lock, NULL)) {
+        hcalv->running = 0;
+        return AKFS_ERROR;
+    }
+
+    if (pthread_cond_init(&hcalv->cond, NULL)) {
+        pthread_mutex_destroy(&hcalv->lock);
+        hcalv->running = 0;
+        return AKFS_ERROR;
+    }
+
+    if (pthread_create(&hcalv->thread, NULL, CalibThread, hcalv)) {
+        pthread_cond_destroy(&hcalv->cond);
+        pthread_mutex_destroy(&hcalv->lock);
+        hcalv->running = 0;
+        return AKFS_ERROR;
+    }
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * AKFS_StopCalib
+ */
+void AKFS_StopCalib(AKFS_CALIB_VAR *hcalv)
+{
+    if (!hcalv->running) {
+        return;
+    }
+
+    pthread_mutex_lock(&hcalv->lock);
+    hcalv->running = 0;
+    pthread_cond_signal(&hcalv->cond);
+    pthread_mutex_unlock(&hcalv->lock);
+
+    pthread_join(hcalv->thread, NULL);
+    pthread_cond_destroy(&hcalv->cond);
+    pthread_mutex_destroy(&hcalv->lock);
+}
+
+/*
+ * AKFS_PushCalib
+ */
+int16_t AKFS_PushCalib(
+                            /*!< (o) : new offset(AKFS_SUCCESS), none(AKFS_ERROR) */
+    AKFS_CALIB_VAR *hcalv,  /*!< (i/o) : solver state */
+    const AKFVEC   hdata[], /*!< (i)   : raw vectors, oldest first */
+    const int16_t  nbuf,    /*!< (i)   : number of vectors */
+    uint32_t       *gen,    /*!< (i/o) : generation seen by the caller */
+    AKFVEC         *ho,     /*!< (o)   : offset */
+    AKFVEC         *hs      /*!< (o)   : sensitivity */
+)
+{
+    int16_t ret = AKFS_ERROR;
+    int16_t queued = 0;
+    int16_t i;
+
+    if (!hcalv->running) {
+        return AKFS_ERROR;
+    }
+
+    /* one lock round trip for the whole run */
+    pthread_mutex_lock(&hcalv->lock);
+
+    for (i = 0; i < nbuf; i++) {
+        /* only new directions are worth solving for */
+        if (Novel(hcalv, &hdata[i], ho) != AKFS_SUCCESS) {
+            continue;
+        }
+
+        queued = 1;
+
+        /* the solver fell behind, drop the oldest candidate */
+        if (hcalv->head - hcalv->tail == AKFS_CAND_SIZE) {
+            hcalv->tail++;
+        }
+
+        hcalv->cand[hcalv->head % AKFS_CAND_SIZE] = hdata[i];
+        hcalv->head++;
+    }
+
+    if (hcalv->gen != *gen) {
+        *gen = hcalv->gen;
+        *ho = hcalv->ho;
+        *hs = hcalv->hs;
+        ret = AKFS_SUCCESS;
+    }
+
+    if (queued) {
+        pthread_cond_signal(&hcalv->cond);
+    }
+
+    pthread_mutex_unlock(&hcalv->lock);
+
+    return ret;
+}
@@ -0,0 +1,107 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#ifndef AKFS_INC_CALIB_H
+#define AKFS_INC_CALIB_H
+
+#include <pthread.h>
+#include "akfs_aoc.h"
+#include "akfs_ellipsoid.h"
+
+/***** Constant definition ****************************************************/
+#define AKFS_CAND_SIZE   64 /* power of two, candidates waiting for the solver */
+#define AKFS_CALIB_NICE  10 /* the solver runs below the sample path */
+#define AKFS_GATE_SIZE   4  /* recent accepted directions */
+
+/* Smallest angle, in degree, between a new candidate and the recently
+ * accepted ones. Samples of a device at rest never reach the solver. */
+#ifndef AKFS_CALIB_ANGLE
+#define AKFS_CALIB_ANGLE  5
+#endif
+
+/* Magnetic calibration engine, see i16_hcalib */
+#define AKFS_HCALIB_AOC        0
+#define AKFS_HCALIB_ELLIPSOID  1
+
+#ifndef AKFS_HCALIB
+#define AKFS_HCALIB  AKFS_HCALIB_AOC
+#endif
+
+/***** Type declaration *******************************************************/
+/*
+ * Offset estimation runs in its own thread. The sample path only queues
+ * raw vectors in cand[] and picks up the last published offset, both under
+ * lock, which is never held while the solver works.
+ */
+typedef struct _AKFS_CALIB_VAR {
+    /* shared, guarded by lock */
+    AKFVEC          cand[AKFS_CAND_SIZE];
+    uint32_t        head;     /* next candidate to write */
+    uint32_t        tail;     /* next candidate to solve */
+    AKFVEC          ho;       /* published offset */
+    AKFVEC          hs;       /* published sensitivity */
+    uint32_t        gen;      /* bumped on every publish */
+    int16_t         running;
+
+    /* owned by the sample path, novelty gate */
+    AKFVEC          gate[AKFS_GATE_SIZE]; /* unit directions, offset removed */
+    uint32_t        ngate;                /* directions accepted so far */
+    AKFLOAT         gcos2;                /* squared cosine of the angle */
+
+    /* owned by the solver thread */
+    AKFS_AOC_VAR    aocv;
+    AKFS_ELL_VAR    ellv;
+    AKFVEC          wo;
+    AKFVEC          ws;
+    AKFLOAT         sense;
+    int16_t         hcalib;
+
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} AKFS_CALIB_VAR;
+
+/***** Prototype of function **************************************************/
+AKLIB_C_API_START
+void AKFS_InitCalib(
+    AKFS_CALIB_VAR *hcalv
+);
+
+int16_t AKFS_StartCalib(
+    AKFS_CALIB_VAR *hcalv,
+    const int16_t  hcalib,
+    const AKFLOAT  angle,
+    const AKFLOAT  sense,
+    const AKFVEC   *ho,
+    const AKFVEC   *hs
+);
+
+void AKFS_StopCalib(
+    AKFS_CALIB_VAR *hcalv
+);
+
+int16_t AKFS_PushCalib(
+    AKFS_CALIB_VAR *hcalv,
+    const AKFVEC   hdata[],
+    const int16_t  nbuf,
+    uint32_t       *gen,
+    AKFVEC         *ho,
+    AKFVEC         *hs
+);
+
+AKLIB_C_API_END
+#endif
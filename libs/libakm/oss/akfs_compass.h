@@ -23,9 +23,12 @@
 
 /* Include files for AKM OSS library */
 #include "akfs_aoc.h"
+#include "akfs_calib.h"
 #include "akfs_configure.h"
 #include "akfs_device.h"
 #include "akfs_direction.h"
+#include "akfs_ellipsoid.h"
+#include "akfs_fusion.h"
 #include "akfs_math.h"
 #include "akfs_vnorm.h"
 
@@ -43,6 +46,12 @@ struct AKL_NV_PRMS {
     uint32_t magic;
     /*! Offset of magnetic vector */
     AKFVEC   fv_hsuc_ho;
+    /*! Magnitude of the calibrated field when the offset was saved (uT) */
+    AKFLOAT  f_hsuc_hr;
+    /*! Wall clock time of the save, in seconds */
+    uint32_t u32_hsuc_time;
+    /*! Accuracy of the offset when it was saved, from 0 to 3 */
+    int16_t  i16_hsuc_status;
 };
 
 struct AKL_SCL_PRMS {
@@ -50,26 +59,37 @@ struct AKL_SCL_PRMS {
 
     /* Variables forAOC. */
     AKFVEC             fva_hdata[AKFS_HDATA_SIZE];
-    AKFS_AOC_VAR       s_aocv;
+
+    /* Variables for the calibration thread. */
+    AKFS_CALIB_VAR     s_calv;
+    uint32_t           u32_hgen;
+    int16_t            i16_hcalib;
 
     /* Variables for Magnetometer buffer. */
-    AKFVEC             fva_hvbuf[AKFS_HDATA_SIZE];
+    AKFS_VBUF          s_hvbuf;
     AKFVEC             fv_ho;
     AKFVEC             fv_hs;
 
     /* Variables for Accelerometer buffer. */
-    AKFVEC             fva_avbuf[AKFS_ADATA_SIZE];
+    AKFS_VBUF          s_avbuf;
     AKFVEC             fv_ao;
     AKFVEC             fv_as;
 
+    /* Variables for gyroscope fusion. */
+    AKFS_FUSION_VAR    s_fusv;
+
     /* Variables for Direction. */
     AKFLOAT            f_azimuth;
-    AKFLOAT            f_pitch;
-    AKFLOAT            f_roll;
+    AKFVEC             fv_gdir;
 
     /* Variables for vector output */
     AKFVEC             fv_hvec;
     AKFVEC             fv_avec;
     int16_t            i16_hstatus;
+
+    /* Variables for warm start, the saved offset is on probation. */
+    AKFLOAT            f_hwr;        /* expected field magnitude, 0 if done */
+    int16_t            i16_hwstatus; /* accuracy the saved offset may reach */
+    int16_t            i16_hwcnt;    /* matching samples toward next step */
 };
 #endif
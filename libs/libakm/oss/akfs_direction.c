@@ -37,132 +37,222 @@
 
 
 /******************************************************************************/
-/*! This function is used internally, so output is RADIAN!
+/*! Output is DEGREE!
+  The sine of pitch and roll is a component of the normalized gravity and
+  the cosine follows from it, so only one atan2 is needed per sample.
+  @return None
+  @param[in] hvec
+  @param[in] gvec Normalized gravity
+  @param[out] azimuth
+ */
+static void AKFS_Heading(
+    const AKFVEC *hvec,
+    const AKFVEC *gvec,
+    AKFLOAT      *azimuth)
+{
+    AKFLOAT sinP;        /* sin value of pitch angle */
+    AKFLOAT cosP;        /* cos value of pitch angle */
+    AKFLOAT sinR;        /* sin value of roll angle */
+    AKFLOAT cosR;        /* cos value of roll angle */
+    AKFLOAT Xh;          /* X axis element of vector which is projected to horizontal plane */
+    AKFLOAT Yh;          /* Y axis element of vector which is projected to horizontal plane */
+
+    /* pitch and roll lie in [-90, 90], so their cosine is never negative */
+    sinP = -(gvec->u.y);
+    sinR = gvec->u.x;
+    cosP = AKFS_SQRT(((1 - sinP * sinP) > 0) ? (1 - sinP * sinP) : 0);
+    cosR = AKFS_SQRT(((1 - sinR * sinR) > 0) ? (1 - sinR * sinR) : 0);
+
+    Yh = -(hvec->u.x) * cosR + (hvec->u.z) * sinR;
+    Xh = (hvec->u.x) * sinP * sinR + (hvec->u.y) * cosP + (hvec->u.z) * sinP *
+        cosR;
+
+    /* atan2(y, x) -> divisor and dividend is opposite from mathematical equation. */
+    *azimuth = RAD2DEG(AKFS_ATAN2(Yh, Xh));
+
+    /* Adjust range of azimuth */
+    if (*azimuth < 0) {
+        *azimuth += 360.0f;
+    }
+}
+
+/******************************************************************************/
+/*! Output is DEGREE!
+  Heading is taken straight from the averaged vectors.
   @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
-  @param[in] avec
-  @param[out] pitch
-  @param[out] roll
+  @param[in] hvbuf
+  @param[in] avbuf
+  @param[out] azimuth
+  @param[out] gvec Normalized gravity, for #AKFS_Angle
  */
-static int16_t AKFS_Angle(
-    const AKFVEC *avec,
-    AKFLOAT      *pitch, /* radian */
-    AKFLOAT      *roll   /* radian */
-)
+int16_t AKFS_Direction(
+    const AKFS_VBUF *hvbuf,
+    const AKFS_VBUF *avbuf,
+    AKFLOAT         *azimuth,
+    AKFVEC          *gvec)
 {
+    AKFVEC  have, aave;
     AKFLOAT av;          /* Size of vector */
 
+    /* average, kept up to date by AKFS_VbPush */
+    if (AKFS_VbAve(hvbuf, AKFS_VBUF_DIR, &have) != AKFS_SUCCESS) {
+        return AKFS_ERROR;
+    }
+
+    if (AKFS_VbAve(avbuf, AKFS_VBUF_DIR, &aave) != AKFS_SUCCESS) {
+        return AKFS_ERROR;
+    }
+
     av =
         AKFS_SQRT(
-            (avec->u.x) * (avec->u.x) + (avec->u.y) * (avec->u.y) + (avec->u.z) *
-            (avec->u.z));
+            (aave.u.x) * (aave.u.x) + (aave.u.y) * (aave.u.y) + (aave.u.z) *
+            (aave.u.z));
 
     if (av < AKFS_EPSILON) {
         return AKFS_ERROR;
     }
 
-    *pitch = AKFS_ASIN(-(avec->u.y) / av);
-    *roll = AKFS_ASIN((avec->u.x) / av);
+    gvec->u.x = aave.u.x / av;
+    gvec->u.y = aave.u.y / av;
+    gvec->u.z = aave.u.z / av;
+
+    AKFS_Heading(&have, gvec, azimuth);
 
     return AKFS_SUCCESS;
 }
 
 /******************************************************************************/
-/*! This function is used internally, so output is RADIAN!
+/*! Output is DEGREE!
+  Same as #AKFS_Direction, but from an attitude quaternion. Its up and north
+  rows stand in for gravity and the magnetic vector.
   @return None
-  @param[in] hvec
-  @param[in] pitch
-  @param[in] roll
+  @param[in] quat (x, y, z, w)
   @param[out] azimuth
+  @param[out] gvec Normalized gravity, for #AKFS_Angle
  */
-static void AKFS_Azimuth(
-    const AKFVEC  *hvec,
-    const AKFLOAT pitch,   /* radian */
-    const AKFLOAT roll,    /* radian */
-    AKFLOAT       *azimuth /* radian */
-)
+void AKFS_DirectionQuat(
+    const AKFLOAT quat[4],
+    AKFLOAT       *azimuth,
+    AKFVEC        *gvec)
 {
-    AKFLOAT sinP;          /* sin value of pitch angle */
-    AKFLOAT cosP;          /* cos value of pitch angle */
-    AKFLOAT sinR;          /* sin value of roll angle */
-    AKFLOAT cosR;          /* cos value of roll angle */
-    AKFLOAT Xh;            /* X axis element of vector which is projected to horizontal plane */
-    AKFLOAT Yh;            /* Y axis element of vector which is projected to horizontal plane */
-
-    sinP = AKFS_SIN(pitch);
-    cosP = AKFS_COS(pitch);
-    sinR = AKFS_SIN(roll);
-    cosR = AKFS_COS(roll);
+    AKFVEC north;
 
-    Yh = -(hvec->u.x) * cosR + (hvec->u.z) * sinR;
-    Xh = (hvec->u.x) * sinP * sinR + (hvec->u.y) * cosP + (hvec->u.z) * sinP *
-        cosR;
+    gvec->u.x = 2 * (quat[0] * quat[2] - quat[1] * quat[3]);
+    gvec->u.y = 2 * (quat[1] * quat[2] + quat[0] * quat[3]);
+    gvec->u.z = 1 - 2 * (quat[0] * quat[0] + quat[1] * quat[1]);
+    north.u.x = 2 * (quat[0] * quat[1] + quat[2] * quat[3]);
+    north.u.y = 1 - 2 * (quat[0] * quat[0] + quat[2] * quat[2]);
+    north.u.z = 2 * (quat[1] * quat[2] - quat[0] * quat[3]);
 
-    /* atan2(y, x) -> divisor and dividend is opposite from mathematical equation. */
-    *azimuth = AKFS_ATAN2(Yh, Xh);
+    AKFS_Heading(&north, gvec, azimuth);
 }
 
 /******************************************************************************/
-/*! Output is DEGREE!
-  @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
-  @param[in] nhvec
-  @param[in] hvec
-  @param[in] hnave
-  @param[in] navec
-  @param[in] avec
-  @param[in] anave
-  @param[out] azimuth
+/*! Output is DEGREE! Only needed when the angles are reported.
+  @return None
+  @param[in] gvec Normalized gravity from #AKFS_Direction
   @param[out] pitch
   @param[out] roll
  */
-int16_t AKFS_Direction(
-    const int16_t nhvec,
-    const AKFVEC  hvec[],
-    const int16_t hnave,
-    const int16_t navec,
-    const AKFVEC  avec[],
-    const int16_t anave,
-    AKFLOAT       *azimuth,
-    AKFLOAT       *pitch,
-    AKFLOAT       *roll)
+void AKFS_Angle(
+    const AKFVEC *gvec,
+    AKFLOAT      *pitch,
+    AKFLOAT      *roll)
+{
+    *pitch = RAD2DEG(AKFS_ASIN(-(gvec->u.y)));
+    *roll = RAD2DEG(AKFS_ASIN(gvec->u.x));
+}
+
+/******************************************************************************/
+/*! Quaternion of the device attitude, from the same averaged vectors as the
+  direction. The rotation matrix rows are east, north and up in device
+  coordinates, as in Android's getRotationMatrix().
+  @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
+  @param[in] hvbuf
+  @param[in] avbuf
+  @param[out] quat (x, y, z, w), w is not negative
+ */
+int16_t AKFS_Quaternion(
+    const AKFS_VBUF *hvbuf,
+    const AKFS_VBUF *avbuf,
+    AKFLOAT         quat[4])
 {
     AKFVEC  have, aave;
-    AKFLOAT azimuthRad;
-    AKFLOAT pitchRad;
-    AKFLOAT rollRad;
+    AKFVEC  e, n, u;
+    AKFLOAT r[3][3];
+    AKFLOAT len, t, s;
+    int16_t i;
 
-    /* arguments check */
-    if ((nhvec <= 0) || (navec <= 0) || (hnave <= 0) || (anave <= 0)) {
+    if (AKFS_VbAve(hvbuf, AKFS_VBUF_DIR, &have) != AKFS_SUCCESS) {
         return AKFS_ERROR;
     }
 
-    if ((nhvec < hnave) || (navec < anave)) {
+    if (AKFS_VbAve(avbuf, AKFS_VBUF_DIR, &aave) != AKFS_SUCCESS) {
         return AKFS_ERROR;
     }
 
-    /* average */
-    if (AKFS_VbAve(nhvec, hvec, hnave, &have) != AKFS_SUCCESS) {
+    /* east = h x a, north = a x east */
+    e.u.x = have.u.y * aave.u.z - have.u.z * aave.u.y;
+    e.u.y = have.u.z * aave.u.x - have.u.x * aave.u.z;
+    e.u.z = have.u.x * aave.u.y - have.u.y * aave.u.x;
+    len = AKFS_SQRT(e.u.x * e.u.x + e.u.y * e.u.y + e.u.z * e.u.z);
+
+    /* free fall, or the field is parallel to gravity */
+    if (len < AKFS_EPSILON) {
         return AKFS_ERROR;
     }
 
-    if (AKFS_VbAve(navec, avec, anave, &aave) != AKFS_SUCCESS) {
-        return AKFS_ERROR;
+    t = AKFS_SQRT(aave.u.x * aave.u.x + aave.u.y * aave.u.y +
+                  aave.u.z * aave.u.z);
+
+    for (i = 0; i < 3; i++) {
+        e.v[i] /= len;
+        u.v[i] = aave.v[i] / t;
     }
 
-    /* calculate pitch and roll */
-    if (AKFS_Angle(&aave, &pitchRad, &rollRad) != AKFS_SUCCESS) {
-        return AKFS_ERROR;
+    n.u.x = u.u.y * e.u.z - u.u.z * e.u.y;
+    n.u.y = u.u.z * e.u.x - u.u.x * e.u.z;
+    n.u.z = u.u.x * e.u.y - u.u.y * e.u.x;
+
+    for (i = 0; i < 3; i++) {
+        r[0][i] = e.v[i];
+        r[1][i] = n.v[i];
+        r[2][i] = u.v[i];
     }
 
-    /* calculate azimuth */
-    AKFS_Azimuth(&have, pitchRad, rollRad, &azimuthRad);
+    /* matrix to quaternion, divide by the largest component */
+    t = r[0][0] + r[1][1] + r[2][2];
 
-    *azimuth = RAD2DEG(azimuthRad);
-    *pitch = RAD2DEG(pitchRad);
-    *roll = RAD2DEG(rollRad);
+    if (t > 0) {
+        s = AKFS_SQRT(t + 1) * 2;
+        quat[3] = s / 4;
+        quat[0] = (r[2][1] - r[1][2]) / s;
+        quat[1] = (r[0][2] - r[2][0]) / s;
+        quat[2] = (r[1][0] - r[0][1]) / s;
+    } else if ((r[0][0] > r[1][1]) && (r[0][0] > r[2][2])) {
+        s = AKFS_SQRT(1 + r[0][0] - r[1][1] - r[2][2]) * 2;
+        quat[3] = (r[2][1] - r[1][2]) / s;
+        quat[0] = s / 4;
+        quat[1] = (r[0][1] + r[1][0]) / s;
+        quat[2] = (r[0][2] + r[2][0]) / s;
+    } else if (r[1][1] > r[2][2]) {
+        s = AKFS_SQRT(1 + r[1][1] - r[0][0] - r[2][2]) * 2;
+        quat[3] = (r[0][2] - r[2][0]) / s;
+        quat[0] = (r[0][1] + r[1][0]) / s;
+        quat[1] = s / 4;
+        quat[2] = (r[1][2] + r[2][1]) / s;
+    } else {
+        s = AKFS_SQRT(1 + r[2][2] - r[0][0] - r[1][1]) * 2;
+        quat[3] = (r[1][0] - r[0][1]) / s;
+        quat[0] = (r[0][2] + r[2][0]) / s;
+        quat[1] = (r[1][2] + r[2][1]) / s;
+        quat[2] = s / 4;
+    }
 
-    /* Adjust range of azimuth */
-    if (*azimuth < 0) {
-        *azimuth += 360.0f;
+    if (quat[3] < 0) {
+        for (i = 0; i < 4; i++) {
+            quat[i] = -quat[i];
+        }
     }
 
     return AKFS_SUCCESS;
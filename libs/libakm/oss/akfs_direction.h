@@ -19,19 +19,33 @@
 #define AKFS_INC_DIRECTION_H
 
 #include "akfs_device.h"
+#include "akfs_vnorm.h"
 
 /***** Prototype of function **************************************************/
 AKLIB_C_API_START
 int16_t AKFS_Direction(
-    const int16_t nhvec,
-    const AKFVEC  hvec[],
-    const int16_t hnave,
-    const int16_t navec,
-    const AKFVEC  avec[],
-    const int16_t anave,
+    const AKFS_VBUF *hvbuf,
+    const AKFS_VBUF *avbuf,
+    AKFLOAT         *azimuth,
+    AKFVEC          *gvec
+);
+
+void AKFS_DirectionQuat(
+    const AKFLOAT quat[4],
     AKFLOAT       *azimuth,
-    AKFLOAT       *pitch,
-    AKFLOAT       *roll
+    AKFVEC        *gvec
+);
+
+void AKFS_Angle(
+    const AKFVEC *gvec,
+    AKFLOAT      *pitch,
+    AKFLOAT      *roll
+);
+
+int16_t AKFS_Quaternion(
+    const AKFS_VBUF *hvbuf,
+    const AKFS_VBUF *avbuf,
+    AKFLOAT         quat[4]
 );
 
 AKLIB_C_API_END
@@ -0,0 +1,211 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#include "akfs_ellipsoid.h"
+#include "akfs_math.h"
+
+/*
+ * Solve
+ */
+static int16_t Solve(
+    const AKFS_ELL_VAR *hellv, /*!< (i)  : accumulated moments */
+    double             p[]     /*!< (o)  : ellipsoid parameters */
+)
+{
+    double  a[AKFS_ELL_PARAMS][AKFS_ELL_PARAMS + 1];
+    double  t;
+    int16_t i, j, k, m;
+
+    for (i = 0; i < AKFS_ELL_PARAMS; i++) {
+        for (j = 0; j < AKFS_ELL_PARAMS; j++) {
+            a[i][j] = (j < i) ? hellv->mtm[j][i] : hellv->mtm[i][j];
+        }
+
+        a[i][AKFS_ELL_PARAMS] = hellv->mtb[i];
+    }
+
+    /* Gaussian elimination with partial pivoting */
+    for (k = 0; k < AKFS_ELL_PARAMS; k++) {
+        m = k;
+
+        for (i = k + 1; i < AKFS_ELL_PARAMS; i++) {
+            if (fabs(a[i][k]) > fabs(a[m][k])) {
+                m = i;
+            }
+        }
+
+        if (fabs(a[m][k]) < 1e-9 * hellv->weight) {
+            return AKFS_ERROR;
+        }
+
+        if (m != k) {
+            for (j = k; j <= AKFS_ELL_PARAMS; j++) {
+                t = a[k][j];
+                a[k][j] = a[m][j];
+                a[m][j] = t;
+            }
+        }
+
+        for (i = k + 1; i < AKFS_ELL_PARAMS; i++) {
+            t = a[i][k] / a[k][k];
+
+            for (j = k; j <= AKFS_ELL_PARAMS; j++) {
+                a[i][j] -= t * a[k][j];
+            }
+        }
+    }
+
+    for (i = AKFS_ELL_PARAMS - 1; i >= 0; i--) {
+        t = a[i][AKFS_ELL_PARAMS];
+
+        for (j = i + 1; j < AKFS_ELL_PARAMS; j++) {
+            t -= a[i][j] * p[j];
+        }
+
+        p[i] = t / a[i][i];
+    }
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * AKFS_Ellipsoid
+ */
+int16_t AKFS_Ellipsoid(
+                          /*!< (o) : calibration success(AKFS_SUCCESS), failure(AKFS_ERROR) */
+    AKFS_ELL_VAR  *hellv, /*!< (i/o)	: accumulated moments */
+    const AKFVEC  *hdata, /*!< (i)	: vectors of data    */
+    const AKFLOAT sense,  /*!< (i)	: nominal sensitivity */
+    AKFVEC        *ho,    /*!< (i/o)	: offset             */
+    AKFVEC        *hs     /*!< (i/o)	: sensitivity per axis */
+)
+{
+    double  phi[AKFS_ELL_PARAMS];
+    double  p[AKFS_ELL_PARAMS];
+    double  v[3];
+    double  o[3];
+    double  r[3];
+    double  k, rmin, rmax, rmean, mean, var;
+    int16_t i, j;
+
+    /* accumulate, the oldest samples fade out */
+    for (i = 0; i < 3; i++) {
+        v[i] = hdata[0].v[i] / AKFS_ELL_NORM;
+    }
+
+    phi[0] = v[1] * v[1];
+    phi[1] = v[2] * v[2];
+    phi[2] = v[0];
+    phi[3] = v[1];
+    phi[4] = v[2];
+    phi[5] = 1.0;
+
+    for (i = 0; i < AKFS_ELL_PARAMS; i++) {
+        for (j = i; j < AKFS_ELL_PARAMS; j++) {
+            hellv->mtm[i][j] = AKFS_ELL_FORGET * hellv->mtm[i][j]
+                + phi[i] * phi[j];
+        }
+
+        hellv->mtb[i] = AKFS_ELL_FORGET * hellv->mtb[i] - phi[i] * v[0] * v[0];
+    }
+
+    for (i = 0; i < 3; i++) {
+        hellv->sum[i] = AKFS_ELL_FORGET * hellv->sum[i] + v[i];
+        hellv->sq[i] = AKFS_ELL_FORGET * hellv->sq[i] + v[i] * v[i];
+    }
+
+    hellv->weight = AKFS_ELL_FORGET * hellv->weight + 1.0;
+
+    if (hellv->weight < AKFS_ELL_MIN_W) {
+        return AKFS_ERROR;
+    }
+
+    /* least squares fit */
+    if (Solve(hellv, p) != AKFS_SUCCESS) {
+        return AKFS_ERROR;
+    }
+
+    if ((p[0] <= 0.0) || (p[1] <= 0.0)) {
+        return AKFS_ERROR;
+    }
+
+    o[0] = -p[2] / 2.0;
+    o[1] = -p[3] / (2.0 * p[0]);
+    o[2] = -p[4] / (2.0 * p[1]);
+    k = o[0] * o[0] + p[0] * o[1] * o[1] + p[1] * o[2] * o[2] - p[5];
+
+    if (k <= 0.0) {
+        return AKFS_ERROR;
+    }
+
+    r[0] = sqrt(k);
+    r[1] = sqrt(k / p[0]);
+    r[2] = sqrt(k / p[1]);
+    rmin = r[0];
+    rmax = r[0];
+    rmean = 0.0;
+
+    for (i = 0; i < 3; i++) {
+        rmin = (r[i] < rmin) ? r[i] : rmin;
+        rmax = (r[i] > rmax) ? r[i] : rmax;
+        rmean += r[i] / 3.0;
+    }
+
+    /* reject fits that the samples do not support */
+    if (rmax > AKFS_ELL_RATIO * rmin) {
+        return AKFS_ERROR;
+    }
+
+    for (i = 0; i < 3; i++) {
+        mean = hellv->sum[i] / hellv->weight;
+        var = hellv->sq[i] / hellv->weight - mean * mean;
+
+        if (var < (AKFS_ELL_SPREAD * r[i]) * (AKFS_ELL_SPREAD * r[i])) {
+            return AKFS_ERROR;
+        }
+    }
+
+    for (i = 0; i < 3; i++) {
+        ho->v[i] = (AKFLOAT)(o[i] * AKFS_ELL_NORM);
+        hs->v[i] = (AKFLOAT)(sense * r[i] / rmean);
+    }
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * AKFS_InitEllipsoid
+ */
+void AKFS_InitEllipsoid(AKFS_ELL_VAR *hellv)
+{
+    int16_t i, j;
+
+    for (i = 0; i < AKFS_ELL_PARAMS; i++) {
+        for (j = 0; j < AKFS_ELL_PARAMS; j++) {
+            hellv->mtm[i][j] = 0.0;
+        }
+
+        hellv->mtb[i] = 0.0;
+    }
+
+    for (i = 0; i < 3; i++) {
+        hellv->sum[i] = 0.0;
+        hellv->sq[i] = 0.0;
+    }
+
+    hellv->weight = 0.0;
+}
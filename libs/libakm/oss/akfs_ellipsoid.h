@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#ifndef AKFS_INC_ELLIPSOID_H
+#define AKFS_INC_ELLIPSOID_H
+
+#include "akfs_device.h"
+
+/***** Constant definition ****************************************************/
+#define AKFS_ELL_PARAMS   6     /* y^2, z^2, x, y, z, 1 */
+#define AKFS_ELL_FORGET   0.996 /* about 250 samples of memory */
+#define AKFS_ELL_MIN_W    32.0  /* samples before a fit is trusted */
+#define AKFS_ELL_NORM     50.0  /* uT, keeps the moments well scaled */
+#define AKFS_ELL_SPREAD   0.3   /* minimum deviation per axis / radius */
+#define AKFS_ELL_RATIO    1.5   /* maximum ratio of the radii */
+
+/***** Type declaration *******************************************************/
+/*
+ * Exponentially weighted moments of the axis aligned ellipsoid
+ * x^2 + b*y^2 + c*z^2 + d*x + e*y + f*z + g = 0, accumulated in double
+ * since the fourth order moments lose too much precision in float.
+ */
+typedef struct _AKFS_ELL_VAR {
+    double mtm[AKFS_ELL_PARAMS][AKFS_ELL_PARAMS];
+    double mtb[AKFS_ELL_PARAMS];
+    double sum[3];  /* per axis sums, for the spread check */
+    double sq[3];
+    double weight;
+} AKFS_ELL_VAR;
+
+/***** Prototype of function **************************************************/
+AKLIB_C_API_START
+int16_t AKFS_Ellipsoid(
+    AKFS_ELL_VAR  *hellv,
+    const AKFVEC  *hdata,
+    const AKFLOAT sense,
+    AKFVEC        *ho,
+    AKFVEC        *hs
+);
+
+void AKFS_InitEllipsoid(
+    AKFS_ELL_VAR *hellv
+);
+
+AKLIB_C_API_END
+#endif
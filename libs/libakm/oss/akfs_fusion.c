@@ -0,0 +1,210 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#include "akfs_fusion.h"
+#include "akfs_direction.h"
+#include "akfs_math.h"
+
+/*
+ * Cross
+ */
+static void Cross(
+    const AKFVEC *a, /*!< (i) : left */
+    const AKFVEC *b, /*!< (i) : right */
+    AKFVEC       *c  /*!< (o) : a x b */
+)
+{
+    c->u.x = a->u.y * b->u.z - a->u.z * b->u.y;
+    c->u.y = a->u.z * b->u.x - a->u.x * b->u.z;
+    c->u.z = a->u.x * b->u.y - a->u.y * b->u.x;
+}
+
+/*
+ * Normalize
+ */
+static int16_t Normalize(
+    AKFLOAT       *v, /*!< (i/o) : vector */
+    const int16_t n   /*!< (i)   : number of elements */
+)
+{
+    AKFLOAT len = 0;
+    int16_t i;
+
+    for (i = 0; i < n; i++) {
+        len += v[i] * v[i];
+    }
+
+    len = AKFS_SQRT(len);
+
+    if (len < AKFS_EPSILON) {
+        return AKFS_ERROR;
+    }
+
+    for (i = 0; i < n; i++) {
+        v[i] /= len;
+    }
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * Error
+ */
+static int16_t Error(
+                             /*!< (o) : error valid(AKFS_SUCCESS), no reference(AKFS_ERROR) */
+    const AKFLOAT   q[4],    /*!< (i) : attitude */
+    const AKFS_VBUF *hvbuf,  /*!< (i) : magnetic vectors */
+    const AKFS_VBUF *avbuf,  /*!< (i) : acceleration vectors */
+    AKFVEC          *err     /*!< (o) : rotation from estimate to measurement */
+)
+{
+    AKFVEC up, east, north;
+    AKFVEC vup, vnorth;
+    AKFVEC have, t;
+
+    if ((AKFS_VbAve(hvbuf, AKFS_VBUF_DIR, &have) != AKFS_SUCCESS) ||
+        (AKFS_VbAve(avbuf, AKFS_VBUF_DIR, &up) != AKFS_SUCCESS)) {
+        return AKFS_ERROR;
+    }
+
+    /* measured directions, device coordinates */
+    Cross(&have, &up, &east);
+
+    if ((Normalize(up.v, 3) != AKFS_SUCCESS) ||
+        (Normalize(east.v, 3) != AKFS_SUCCESS)) {
+        return AKFS_ERROR;
+    }
+
+    Cross(&up, &east, &north);
+
+    /* estimated directions, rows of the rotation matrix */
+    vup.u.x = 2 * (q[0] * q[2] - q[1] * q[3]);
+    vup.u.y = 2 * (q[1] * q[2] + q[0] * q[3]);
+    vup.u.z = 1 - 2 * (q[0] * q[0] + q[1] * q[1]);
+    vnorth.u.x = 2 * (q[0] * q[1] + q[2] * q[3]);
+    vnorth.u.y = 1 - 2 * (q[0] * q[0] + q[2] * q[2]);
+    vnorth.u.z = 2 * (q[1] * q[2] - q[0] * q[3]);
+
+    Cross(&up, &vup, err);
+    Cross(&north, &vnorth, &t);
+    err->u.x += t.u.x;
+    err->u.y += t.u.y;
+    err->u.z += t.u.z;
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * AKFS_FusionGyro
+ */
+int16_t AKFS_FusionGyro(
+                            /*!< (o) : attitude valid(AKFS_SUCCESS), not yet(AKFS_ERROR) */
+    AKFS_FUSION_VAR *hfusv, /*!< (i/o) : filter state */
+    const AKFVEC    *gyr,   /*!< (i)   : rate, rad/s */
+    const uint32_t  time,   /*!< (i)   : time stamp, us */
+    const AKFS_VBUF *hvbuf, /*!< (i)   : magnetic vectors */
+    const AKFS_VBUF *avbuf  /*!< (i)   : acceleration vectors */
+)
+{
+    AKFLOAT dt;
+    AKFVEC  w, err;
+    AKFLOAT q[4];
+    int16_t i;
+
+    /* unsigned difference, time stamps wrap */
+    dt = (AKFLOAT)(uint32_t)(time - hfusv->time) / 1000000.0f;
+    hfusv->time = time;
+    hfusv->gyr = *gyr;
+    hfusv->stale = 0;
+
+    /* start from the acc/mag attitude */
+    if (!hfusv->init) {
+        if (AKFS_Quaternion(hvbuf, avbuf, hfusv->q) != AKFS_SUCCESS) {
+            return AKFS_ERROR;
+        }
+
+        hfusv->init = 1;
+        return AKFS_SUCCESS;
+    }
+
+    if (dt > AKFS_FUSION_MAXDT) {
+        return AKFS_SUCCESS;
+    }
+
+    for (i = 0; i < 3; i++) {
+        w.v[i] = gyr->v[i] - hfusv->bias.v[i];
+    }
+
+    if (Error(hfusv->q, hvbuf, avbuf, &err) == AKFS_SUCCESS) {
+        for (i = 0; i < 3; i++) {
+            hfusv->bias.v[i] -= AKFS_FUSION_KI * err.v[i] * dt;
+            w.v[i] += AKFS_FUSION_KP * err.v[i];
+        }
+    }
+
+    /* q += q * (w, 0) * dt / 2 */
+    for (i = 0; i < 3; i++) {
+        w.v[i] *= dt / 2;
+    }
+
+    q[0] = hfusv->q[3] * w.u.x + hfusv->q[1] * w.u.z - hfusv->q[2] * w.u.y;
+    q[1] = hfusv->q[3] * w.u.y + hfusv->q[2] * w.u.x - hfusv->q[0] * w.u.z;
+    q[2] = hfusv->q[3] * w.u.z + hfusv->q[0] * w.u.y - hfusv->q[1] * w.u.x;
+    q[3] = -hfusv->q[0] * w.u.x - hfusv->q[1] * w.u.y - hfusv->q[2] * w.u.z;
+
+    for (i = 0; i < 4; i++) {
+        hfusv->q[i] += q[i];
+    }
+
+    if (Normalize(hfusv->q, 4) != AKFS_SUCCESS) {
+        hfusv->init = 0;
+        return AKFS_ERROR;
+    }
+
+    return AKFS_SUCCESS;
+}
+
+/*
+ * AKFS_FusionActive
+ */
+int16_t AKFS_FusionActive(const AKFS_FUSION_VAR *hfusv)
+{
+    if (hfusv->init && (hfusv->stale < AKFS_FUSION_STALE)) {
+        return AKFS_SUCCESS;
+    }
+
+    return AKFS_ERROR;
+}
+
+/*
+ * AKFS_InitFusion
+ */
+void AKFS_InitFusion(AKFS_FUSION_VAR *hfusv)
+{
+    int16_t i;
+
+    for (i = 0; i < 3; i++) {
+        hfusv->gyr.v[i] = 0;
+        hfusv->bias.v[i] = 0;
+        hfusv->q[i] = 0;
+    }
+
+    hfusv->q[3] = 1;
+    hfusv->time = 0;
+    hfusv->init = 0;
+    hfusv->stale = AKFS_FUSION_STALE;
+}
@@ -0,0 +1,64 @@
+/******************************************************************************
+ *
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+#ifndef AKFS_INC_FUSION_H
+#define AKFS_INC_FUSION_H
+
+#include "akfs_device.h"
+#include "akfs_vnorm.h"
+
+/***** Constant definition ****************************************************/
+#define AKFS_FUSION_KP     0.5f  /* 1/s, pull toward acc/mag */
+#define AKFS_FUSION_KI     0.02f /* 1/s^2, gyro bias learning */
+#define AKFS_FUSION_MAXDT  0.1f  /* s, longer gaps are not integrated */
+#define AKFS_FUSION_STALE  8     /* acc samples without gyro */
+
+/***** Type declaration *******************************************************/
+/*
+ * Complementary filter: the attitude follows the gyroscope and is pulled
+ * toward gravity and magnetic north by a proportional-integral term, the
+ * integral being the gyro bias.
+ */
+typedef struct _AKFS_FUSION_VAR {
+    AKFLOAT  q[4];   /* (x, y, z, w), device to world */
+    AKFVEC   gyr;    /* last rate, rad/s */
+    AKFVEC   bias;   /* rad/s */
+    uint32_t time;   /* us, of the last rate */
+    int16_t  init;   /* q is valid */
+    int16_t  stale;  /* acc samples since the last rate */
+} AKFS_FUSION_VAR;
+
+/***** Prototype of function **************************************************/
+AKLIB_C_API_START
+void AKFS_InitFusion(
+    AKFS_FUSION_VAR *hfusv
+);
+
+int16_t AKFS_FusionGyro(
+    AKFS_FUSION_VAR *hfusv,
+    const AKFVEC    *gyr,
+    const uint32_t  time,
+    const AKFS_VBUF *hvbuf,
+    const AKFS_VBUF *avbuf
+);
+
+int16_t AKFS_FusionActive(
+    const AKFS_FUSION_VAR *hfusv
+);
+
+AKLIB_C_API_END
+#endif
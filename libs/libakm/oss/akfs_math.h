@@ -24,6 +24,7 @@
 /***** Constant definition ****************************************************/
 #define AKFS_PI  3.141592654f
 #define RAD2DEG(rad)  ((rad) * 180.0f / AKFS_PI)
+#define DEG2RAD(deg)  ((deg) * AKFS_PI / 180.0f)
 
 /***** Macro definition *******************************************************/
 
@@ -15,6 +15,7 @@
  * limitations under the License.
  *
  ******************************************************************************/
+#include <time.h>
 #include "akfs_measure.h"
 
 /*****************************************************************************/
@@ -27,6 +28,10 @@ void AKFS_InitPRMS(struct AKL_SCL_PRMS *prms)
     prms->fv_as.u.x = AKFS_ACC_SENSE;
     prms->fv_as.u.y = AKFS_ACC_SENSE;
     prms->fv_as.u.z = AKFS_ACC_SENSE;
+
+    /* Calibration engine */
+    prms->i16_hcalib = AKFS_HCALIB;
+    AKFS_InitCalib(&prms->s_calv);
 }
 
 /*****************************************************************************/
@@ -35,73 +40,197 @@ void AKFS_SetDefaultNV(struct AKL_NV_PRMS *nv)
     nv->fv_hsuc_ho.u.x = 0;
     nv->fv_hsuc_ho.u.y = 0;
     nv->fv_hsuc_ho.u.z = 0;
+    nv->f_hsuc_hr = 0;
+    nv->u32_hsuc_time = 0;
+    nv->i16_hsuc_status = 0;
+}
+
+/*****************************************************************************/
+/*
+ * Report a provisional accuracy for the saved offset right away. It starts
+ * one step below the saved accuracy, one more if the offset is older than
+ * AKFS_WARM_FRESH, and is given up once older than AKFS_WARM_STALE.
+ */
+static void AKFS_WarmStart(struct AKL_SCL_PRMS *prms)
+{
+    const struct AKL_NV_PRMS *nv = prms->ps_nv;
+    uint32_t                 now = (uint32_t)time(NULL);
+    uint32_t                 age;
+
+    prms->i16_hstatus = 0;
+    prms->f_hwr = 0;
+    prms->i16_hwstatus = 0;
+    prms->i16_hwcnt = 0;
+
+    if ((nv->i16_hsuc_status <= 0) || (nv->f_hsuc_hr <= 0) ||
+        (nv->u32_hsuc_time == 0) || (now < nv->u32_hsuc_time)) {
+        return;
+    }
+
+    age = now - nv->u32_hsuc_time;
+
+    if (age > AKFS_WARM_STALE) {
+        return;
+    }
+
+    prms->i16_hstatus = nv->i16_hsuc_status - 1;
+
+    if (age > AKFS_WARM_FRESH) {
+        prms->i16_hstatus--;
+    }
+
+    if (prms->i16_hstatus < 0) {
+        prms->i16_hstatus = 0;
+    }
+
+    prms->f_hwr = nv->f_hsuc_hr;
+    prms->i16_hwstatus = nv->i16_hsuc_status;
+}
+
+/*****************************************************************************/
+/*
+ * While the field magnitude matches the saved one, raise the accuracy one
+ * step per AKFS_WARM_CONFIRM samples up to the saved accuracy. A mismatch
+ * means the offset no longer fits, e.g. after a magnetized case was added.
+ */
+static void AKFS_WarmCheck(
+    struct AKL_SCL_PRMS *prms,
+    const AKFLOAT       radius,
+    const int16_t       nbuf)
+{
+    AKFLOAT d = radius - prms->f_hwr;
+
+    if ((d > AKFS_WARM_TOL * prms->f_hwr) ||
+        (d < -AKFS_WARM_TOL * prms->f_hwr)) {
+        prms->i16_hstatus = 0;
+        prms->f_hwr = 0;
+        return;
+    }
+
+    prms->i16_hwcnt += nbuf;
+
+    while ((prms->i16_hwcnt >= AKFS_WARM_CONFIRM) &&
+           (prms->i16_hstatus < prms->i16_hwstatus)) {
+        prms->i16_hwcnt -= AKFS_WARM_CONFIRM;
+        prms->i16_hstatus++;
+    }
+
+    if (prms->i16_hstatus >= prms->i16_hwstatus) {
+        prms->f_hwr = 0;
+    }
 }
 
 /*****************************************************************************/
 int16_t AKFS_InitMeasure(struct AKL_SCL_PRMS *prms)
 {
+    const int16_t hnave[AKFS_VBUF_WIN] = { AKFS_HNAVE_V, AKFS_HNAVE_D };
+    const int16_t anave[AKFS_VBUF_WIN] = { AKFS_ANAVE_V, AKFS_ANAVE_D };
+
     /* Restore the value */
     prms->fv_ho = prms->ps_nv->fv_hsuc_ho;
+    AKFS_WarmStart(prms);
 
     /* Initialize buffer */
     AKFS_InitBuffer(AKFS_HDATA_SIZE, prms->fva_hdata);
-    AKFS_InitBuffer(AKFS_HDATA_SIZE, prms->fva_hvbuf);
-    AKFS_InitBuffer(AKFS_ADATA_SIZE, prms->fva_avbuf);
 
-    /* Initialize for AOC */
-    AKFS_InitAOC(&prms->s_aocv);
+    if ((AKFS_InitVbuf(&prms->s_hvbuf, hnave) != AKFS_SUCCESS) ||
+        (AKFS_InitVbuf(&prms->s_avbuf, anave) != AKFS_SUCCESS)) {
+        return AKM_ERROR;
+    }
+
+    /* Initialize for gyroscope fusion */
+    AKFS_InitFusion(&prms->s_fusv);
+
+    /* Level until the first direction is calculated */
+    prms->f_azimuth = 0;
+    prms->fv_gdir.u.x = 0;
+    prms->fv_gdir.u.y = 0;
+    prms->fv_gdir.u.z = 1;
+
+    /* Start offset estimation */
+    prms->u32_hgen = 0;
+
+    if (AKFS_StartCalib(
+            &prms->s_calv,
+            prms->i16_hcalib,
+            AKFS_CALIB_ANGLE,
+            AKFS_MAG_SENSE,
+            &prms->fv_ho,
+            &prms->fv_hs) != AKFS_SUCCESS) {
+        return AKM_ERROR;
+    }
 
     return AKM_SUCCESS;
 }
 
+/*****************************************************************************/
+void AKFS_TermMeasure(struct AKL_SCL_PRMS *prms)
+{
+    struct AKL_NV_PRMS *nv = prms->ps_nv;
+
+    AKFS_StopCalib(&prms->s_calv);
+
+    /* never initialized, there is no record to update */
+    if (nv == NULL) {
+        return;
+    }
+
+    /* an offset still on probation keeps its old record */
+    if (prms->f_hwr > 0) {
+        return;
+    }
+
+    nv->fv_hsuc_ho = prms->fv_ho;
+    nv->i16_hsuc_status = prms->i16_hstatus;
+
+    if (prms->i16_hstatus > 0) {
+        nv->f_hsuc_hr = AKFS_SQRT(
+                (prms->fv_hvec.u.x * prms->fv_hvec.u.x) +
+                (prms->fv_hvec.u.y * prms->fv_hvec.u.y) +
+                (prms->fv_hvec.u.z * prms->fv_hvec.u.z));
+        nv->u32_hsuc_time = (uint32_t)time(NULL);
+    }
+}
+
 /******************************************************************************/
 int16_t AKFS_Set_MAGNETIC_FIELD(
     struct AKL_SCL_PRMS *prms,
-    const AKFLOAT       mag[3])
+    const AKFVEC        mag[],
+    const int16_t       nbuf)
 {
     int16_t akret;
     int16_t aocret;
     AKFLOAT radius;
 
-    /* Make a spare area for new data */
-    akret = AKFS_BufShift(
-            AKFS_ADATA_SIZE,
-            1,
-            prms->fva_avbuf
-        );
-
-    if (akret == AKFS_ERROR) {
-        return AKM_ERROR;
-    }
-
-    /* put new data */
-    /* mag[in]: Android coordinate, sensitivity adjusted. */
-    prms->fva_hdata[0].v[0] = mag[0];
-    prms->fva_hdata[0].v[1] = mag[1];
-    prms->fva_hdata[0].v[2] = mag[2];
+    /* keep the newest data */
+    /* mag[in]: Android coordinate, sensitivity adjusted, oldest first. */
+    prms->fva_hdata[0] = mag[nbuf - 1];
 
-    /* Offset calculation is done in this function */
-    /* hdata[in] : Android coordinate, sensitivity adjusted. */
+    /* Offset calculation is done by the calibration thread. */
+    /* Queue the new data and pick up the last published offset. */
+    /* mag  [in] : Android coordinate, sensitivity adjusted. */
     /* ho   [out]: Android coordinate, sensitivity adjusted. */
-    aocret = AKFS_AOC(
-            &prms->s_aocv,
-            prms->fva_hdata,
-            &prms->fv_ho
+    /* hs   [out]: per axis sensitivity, ellipsoid fitting only. */
+    aocret = AKFS_PushCalib(
+            &prms->s_calv,
+            mag,
+            nbuf,
+            &prms->u32_hgen,
+            &prms->fv_ho,
+            &prms->fv_hs
         );
 
-    /* Subtract offset, then put the vector to another buffer. */
-    /* hdata, ho[in] : Android coordinate, sensitivity adjusted. */
-    /* hvbuf    [out]: Android coordinate, sensitivity adjusted, */
-    /*		           offset subtracted. */
+    /* Subtract offset, then put the vectors to another buffer. */
+    /* mag, ho[in] : Android coordinate, sensitivity adjusted. */
+    /* hvbuf  [out]: Android coordinate, sensitivity adjusted, */
+    /*		         offset subtracted. */
     akret = AKFS_VbNorm(
-            AKFS_HDATA_SIZE,
-            prms->fva_hdata,
-            1,
+            nbuf,
+            mag,
             &prms->fv_ho,
             &prms->fv_hs,
             AKFS_MAG_SENSE,
-            AKFS_HDATA_SIZE,
-            prms->fva_hvbuf
+            &prms->s_hvbuf
         );
 
     if (akret == AKFS_ERROR) {
@@ -110,9 +239,8 @@ int16_t AKFS_Set_MAGNETIC_FIELD(
 
     /* Averaging */
     akret = AKFS_VbAve(
-            AKFS_HDATA_SIZE,
-            prms->fva_hvbuf,
-            AKFS_HNAVE_V,
+            &prms->s_hvbuf,
+            AKFS_VBUF_VEC,
             &prms->fv_hvec
         );
 
@@ -128,10 +256,12 @@ int16_t AKFS_Set_MAGNETIC_FIELD(
 
     if (radius > AKFS_GEOMAG_MAX) {
         prms->i16_hstatus = 0;
-    } else {
-        if (aocret == AKFS_SUCCESS) {
-            prms->i16_hstatus = 3;
-        }
+    } else if (aocret == AKFS_SUCCESS) {
+        /* a new offset ends the warm start */
+        prms->i16_hstatus = 3;
+        prms->f_hwr = 0;
+    } else if (prms->f_hwr > 0) {
+        AKFS_WarmCheck(prms, radius, nbuf);
     }
 
     return AKM_SUCCESS;
@@ -140,38 +270,32 @@ int16_t AKFS_Set_MAGNETIC_FIELD(
 /******************************************************************************/
 int16_t AKFS_Set_ACCELEROMETER(
     struct AKL_SCL_PRMS *prms,
-    const AKFLOAT       acc[3])
+    const AKFVEC        acc[],
+    const int16_t       nbuf)
 {
     int16_t akret;
-
-
-    /* Make a spare area for new data */
-    akret = AKFS_BufShift(
-            AKFS_ADATA_SIZE,
-            1,
-            prms->fva_avbuf
-        );
-
-    if (akret == AKFS_ERROR) {
-        return AKM_ERROR;
-    }
+    int16_t i;
 
     /* put new data */
     /* acc [in]: Android coordinate, sensitivity adjusted (SI unit), */
-    /*			 offset subtracted. */
-    prms->fva_avbuf[0].v[0] = acc[0];
-    prms->fva_avbuf[0].v[1] = acc[1];
-    prms->fva_avbuf[0].v[2] = acc[2];
+    /*			 offset subtracted, oldest first. */
+    for (i = 0; i < nbuf; i++) {
+        AKFS_VbPush(&prms->s_avbuf, &acc[i]);
 
-    /* Averaging */
+        /* Fall back to acc/mag only when the gyroscope stops */
+        if (prms->s_fusv.stale < AKFS_FUSION_STALE) {
+            prms->s_fusv.stale++;
+        }
+    }
+
+    /* Averaging once for the run */
     /* avbuf[in] : Android coordinate, sensitivity adjusted, */
     /*			   offset subtracted. */
     /* avec [out]: Android coordinate, sensitivity adjusted, */
     /*			   offset subtracted, averaged. */
     akret = AKFS_VbAve(
-            AKFS_ADATA_SIZE,
-            prms->fva_avbuf,
-            AKFS_ANAVE_V,
+            &prms->s_avbuf,
+            AKFS_VBUF_VEC,
             &prms->fv_avec
         );
 
@@ -181,3 +305,28 @@ int16_t AKFS_Set_ACCELEROMETER(
 
     return AKM_SUCCESS;
 }
+
+/******************************************************************************/
+int16_t AKFS_Set_GYROSCOPE(
+    struct AKL_SCL_PRMS *prms,
+    const AKFLOAT       gyr[3],
+    const uint32_t      time_us)
+{
+    AKFVEC gvec;
+
+    /* gyr [in]: Android coordinate, radian/second. */
+    gvec.v[0] = gyr[0];
+    gvec.v[1] = gyr[1];
+    gvec.v[2] = gyr[2];
+
+    /* Propagate the attitude, corrected by the averaged acc/mag. */
+    AKFS_FusionGyro(
+        &prms->s_fusv,
+        &gvec,
+        time_us,
+        &prms->s_hvbuf,
+        &prms->s_avbuf
+    );
+
+    return AKM_SUCCESS;
+}
@@ -31,6 +31,12 @@
 #define AKFS_HNAVE_V     8
 #define AKFS_ANAVE_V     8
 
+/* Warm start from the saved offset */
+#define AKFS_WARM_FRESH    3600   /* seconds a saved offset is fully trusted */
+#define AKFS_WARM_STALE    604800 /* seconds after which it is not trusted */
+#define AKFS_WARM_TOL      0.1    /* tolerated relative field magnitude change */
+#define AKFS_WARM_CONFIRM  16     /* matching samples per accuracy step */
+
 /*** Type declaration *********************************************************/
 
 /*** Global variables *********************************************************/
@@ -52,6 +58,15 @@ int16_t AKFS_InitMeasure(
     struct AKL_SCL_PRMS *prms
 );
 
+/*!
+ * Stop the calibration thread started by #AKFS_InitMeasure and save the
+ * offset with its accuracy to the NV parameters.
+ * \param[in] prms A pointer to #AKL_SCL_PRMS structure.
+ */
+void AKFS_TermMeasure(
+    struct AKL_SCL_PRMS *prms
+);
+
 /*! This function is called when new magnetometer data is available.  The
   coordination system of input vector is sensor local coordination system.
   The input vector will be converted to micro tesla unit (i.e. uT), then
@@ -61,15 +76,14 @@ int16_t AKFS_InitMeasure(
 
   @return #AKM_SUCCESS on success. Otherwise the return value is #AKM_ERROR.
   @param[in] prms A pointer to #AKMPRMS structure.
-  @param[in] mag A set of measurement data from magnetometer.  X axis value
-  should be in mag[0], Y axis value should be in mag[1], Z axis value should be
-  in mag[2].
-  @param[in] status A status of magnetometer.  This status indicates the result
-  of measurement data, i.e. overflow, success or fail, etc.
+  @param[in] mag Measurement data from magnetometer, oldest first. A burst
+  is processed as a whole, with one offset for all of its vectors.
+  @param[in] nbuf Number of vectors in mag.
  */
 int16_t AKFS_Set_MAGNETIC_FIELD(
     struct AKL_SCL_PRMS *prms,
-    const AKFLOAT       mag[3]
+    const AKFVEC        mag[],
+    const int16_t       nbuf
 );
 
 /*! This function is called when new accelerometer data is available.  The
@@ -78,14 +92,28 @@ int16_t AKFS_Set_MAGNETIC_FIELD(
 
   @return #AKM_SUCCESS on success. Otherwise the return value is #AKM_ERROR.
   @param[in] prms A pointer to #AKMPRMS structure.
-  @param[in] acc A set of measurement data from accelerometer.  X axis value
-  should be in acc[0], Y axis value should be in acc[1], Z axis value should be
-  in acc[2].
-  @param[in] status A status of accelerometer.  This status indicates the result
-  of accelerometer data. Currently, this parameter is not used.
+  @param[in] acc Measurement data from accelerometer, oldest first.
+  @param[in] nbuf Number of vectors in acc.
  */
 int16_t AKFS_Set_ACCELEROMETER(
     struct AKL_SCL_PRMS *prms,
-    const AKFLOAT       acc[3]
+    const AKFVEC        acc[],
+    const int16_t       nbuf
+);
+
+/*! This function is called when new gyroscope data is available.  The
+  coordination system of input vector is Android coordination system.
+  The attitude is propagated with it and corrected toward the averaged
+  accelerometer and magnetometer vectors.
+
+  @return #AKM_SUCCESS on success. Otherwise the return value is #AKM_ERROR.
+  @param[in] prms A pointer to #AKMPRMS structure.
+  @param[in] gyr A set of measurement data from gyroscope in rad/s.
+  @param[in] time_us Time stamp of the data in micro seconds.
+ */
+int16_t AKFS_Set_GYROSCOPE(
+    struct AKL_SCL_PRMS *prms,
+    const AKFLOAT       gyr[3],
+    const uint32_t      time_us
 );
 #endif
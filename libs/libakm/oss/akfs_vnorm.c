@@ -19,36 +19,158 @@
 #include "akfs_vnorm.h"
 
 /******************************************************************************/
-/*! Normalize vector.
+/*! Recalculate the running sums from the ring, so that rounding errors of
+  the incremental updates do not pile up.
+  @param[in/out] vbuf Vector ring buffer
+ */
+static void AKFS_VbResum(AKFS_VBUF *vbuf)
+{
+    int16_t  k, n;
+    uint32_t j;
+
+    for (k = 0; k < AKFS_VBUF_WIN; k++) {
+        vbuf->sum[k].u.x = 0;
+        vbuf->sum[k].u.y = 0;
+        vbuf->sum[k].u.z = 0;
+        n = vbuf->nave[k];
+
+        for (j = 1; (j <= (uint32_t)n) && (j <= vbuf->head); j++) {
+            vbuf->sum[k].u.x += vbuf->vec[(vbuf->head - j) % AKFS_VBUF_SIZE].u.x;
+            vbuf->sum[k].u.y += vbuf->vec[(vbuf->head - j) % AKFS_VBUF_SIZE].u.y;
+            vbuf->sum[k].u.z += vbuf->vec[(vbuf->head - j) % AKFS_VBUF_SIZE].u.z;
+        }
+    }
+}
+
+/******************************************************************************/
+/*! Initialize a vector ring buffer.
   @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
-  @param[in] ndata Size of raw vector buffer
-  @param[in] vdata Raw vector buffer
-  @param[in] nbuf Size of data to be buffered
+  @param[out] vbuf Vector ring buffer
+  @param[in] nave Number of average, per window
+ */
+int16_t AKFS_InitVbuf(
+    AKFS_VBUF     *vbuf,
+    const int16_t nave[AKFS_VBUF_WIN])
+{
+    int16_t k;
+
+    for (k = 0; k < AKFS_VBUF_WIN; k++) {
+        if ((nave[k] <= 0) || (nave[k] > AKFS_VBUF_SIZE)) {
+            return AKFS_ERROR;
+        }
+
+        vbuf->nave[k] = nave[k];
+    }
+
+    vbuf->head = 0;
+    AKFS_VbResum(vbuf);
+
+    return AKFS_SUCCESS;
+}
+
+/******************************************************************************/
+/*! Add a vector to the ring, the oldest one leaves each window.
+  @param[in/out] vbuf Vector ring buffer
+  @param[in] v Newest vector
+ */
+void AKFS_VbPush(
+    AKFS_VBUF    *vbuf,
+    const AKFVEC *v)
+{
+    const AKFVEC *old;
+    int16_t      k;
+
+    for (k = 0; k < AKFS_VBUF_WIN; k++) {
+        if (vbuf->head >= (uint32_t)vbuf->nave[k]) {
+            old = &vbuf->vec[(vbuf->head - vbuf->nave[k]) % AKFS_VBUF_SIZE];
+            vbuf->sum[k].u.x -= old->u.x;
+            vbuf->sum[k].u.y -= old->u.y;
+            vbuf->sum[k].u.z -= old->u.z;
+        }
+
+        vbuf->sum[k].u.x += v->u.x;
+        vbuf->sum[k].u.y += v->u.y;
+        vbuf->sum[k].u.z += v->u.z;
+    }
+
+    vbuf->vec[vbuf->head % AKFS_VBUF_SIZE] = *v;
+    vbuf->head++;
+
+    /* once per lap, amortized O(1) */
+    if ((vbuf->head % AKFS_VBUF_SIZE) == 0) {
+        AKFS_VbResum(vbuf);
+    }
+}
+
+/******************************************************************************/
+/*! Apply y = x * k + b per axis to a run of vectors. AKFVEC is three packed
+  AKFLOATs, so the run is walked as a flat array with k and b repeated over
+  twelve lanes, a whole number of both vectors and SIMD registers. The inner
+  loop has no dependency between lanes and is vectorized by the compiler.
+  @param[in] n Number of vectors
+  @param[in] x Input vectors
+  @param[in] k Scale per axis
+  @param[in] b Bias per axis, added after scaling
+  @param[out] y Output vectors, may not overlap x
+ */
+static void AKFS_VbScale(
+    const int16_t n,
+    const AKFVEC  x[],
+    const AKFLOAT k[3],
+    const AKFLOAT b[3],
+    AKFVEC        y[])
+{
+    const AKFLOAT *px = (const AKFLOAT *)x;
+    AKFLOAT       *py = (AKFLOAT *)y;
+    AKFLOAT       kk[12];
+    AKFLOAT       bb[12];
+    int16_t       len = 3 * n;
+    int16_t       i, m;
+
+    for (m = 0; m < 12; m++) {
+        kk[m] = k[m % 3];
+        bb[m] = b[m % 3];
+    }
+
+    for (i = 0; i + 12 <= len; i += 12) {
+        for (m = 0; m < 12; m++) {
+            py[i + m] = px[i + m] * kk[m] + bb[m];
+        }
+    }
+
+    for (m = 0; i < len; i++, m++) {
+        py[i] = px[i] * kk[m] + bb[m];
+    }
+}
+
+/******************************************************************************/
+/*! Normalize vectors and add them to the ring.
+  Offset and sensitivity are folded into one scale and bias per axis, and
+  of a long run only the vectors that stay in the ring are normalized.
+  @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
+  @param[in] nbuf Number of vectors
+  @param[in] vdata Raw vectors, oldest first
   @param[in] o Offset
   @param[in] s Sensitivity
   @param[in] tgt Target sensitivity
-  @param[in] nvec Size of normalized vector buffer
-  @param[out] vvec Normalized vector buffer
+  @param[in/out] vbuf Normalized vector ring buffer
  */
 int16_t AKFS_VbNorm(
-    const int16_t ndata,
-    const AKFVEC  vdata[],
     const int16_t nbuf,
+    const AKFVEC  vdata[],
     const AKFVEC  *o,
     const AKFVEC  *s,
     const AKFLOAT tgt,
-    const int16_t nvec,
-    AKFVEC        vvec[])
+    AKFS_VBUF     *vbuf)
 {
-    int i;
+    AKFVEC  v[AKFS_VBUF_SIZE];
+    AKFLOAT k[3];
+    AKFLOAT b[3];
+    int16_t n, skip;
+    int16_t i;
 
     /* size check */
-    if ((ndata <= 0) || (nvec <= 0) || (nbuf <= 0)) {
-        return AKFS_ERROR;
-    }
-
-    /* dependency check */
-    if ((nbuf < 1) || (ndata < nbuf) || (nvec < nbuf)) {
+    if (nbuf <= 0) {
         return AKFS_ERROR;
     }
 
@@ -60,67 +182,75 @@ int16_t AKFS_VbNorm(
         return AKFS_ERROR;
     }
 
-    /* calculate and store data to buffer */
-    if (AKFS_BufShift(nvec, nbuf, vvec) != AKFS_SUCCESS) {
-        return AKFS_ERROR;
+    /* (vdata - o) / s * tgt */
+    for (i = 0; i < 3; i++) {
+        k[i] = tgt / s->v[i];
+        b[i] = -o->v[i] * k[i];
+    }
+
+    /* older vectors would be pushed out again within this call */
+    skip = (nbuf > AKFS_VBUF_SIZE) ? (nbuf - AKFS_VBUF_SIZE) : 0;
+    n = nbuf - skip;
+
+    AKFS_VbScale(n, &vdata[skip], k, b, v);
+
+    if (skip == 0) {
+        for (i = 0; i < n; i++) {
+            AKFS_VbPush(vbuf, &v[i]);
+        }
+
+        return AKFS_SUCCESS;
     }
 
-    for (i = 0; i < nbuf; i++) {
-        vvec[i].u.x = ((vdata[i].u.x - o->u.x) / (s->u.x) * (AKFLOAT)tgt);
-        vvec[i].u.y = ((vdata[i].u.y - o->u.y) / (s->u.y) * (AKFLOAT)tgt);
-        vvec[i].u.z = ((vdata[i].u.z - o->u.z) / (s->u.z) * (AKFLOAT)tgt);
+    /* the whole ring is replaced, the sums start over */
+    vbuf->head += skip;
+
+    for (i = 0; i < n; i++) {
+        vbuf->vec[vbuf->head % AKFS_VBUF_SIZE] = v[i];
+        vbuf->head++;
     }
 
+    AKFS_VbResum(vbuf);
+
     return AKFS_SUCCESS;
 }
 
 /******************************************************************************/
 /*! Calculate an averaged vector form a given buffer.
   @return #AKFS_SUCCESS on success. Otherwise the return value is #AKFS_ERROR.
-  @param[in] nvec Size of normalized vector buffer
-  @param[in] vvec Normalized vector buffer
-  @param[in] nave Number of average
+  @param[in] vbuf Normalized vector ring buffer
+  @param[in] win Averaging window, #AKFS_VBUF_VEC or #AKFS_VBUF_DIR
   @param[out] vave Averaged vector
  */
 int16_t AKFS_VbAve(
-    const int16_t nvec,
-    const AKFVEC  vvec[],
-    const int16_t nave,
-    AKFVEC        *vave)
+    const AKFS_VBUF *vbuf,
+    const int16_t   win,
+    AKFVEC          *vave)
 {
-    int i;
+    AKFLOAT n;
 
     /* arguments check */
-    if ((nave <= 0) || (nvec <= 0) || (nvec < nave)) {
+    if ((win < 0) || (win >= AKFS_VBUF_WIN)) {
         return AKFS_ERROR;
     }
 
     /* calculate average */
-    vave->u.x = 0;
-    vave->u.y = 0;
-    vave->u.z = 0;
-
-    for (i = 0; i < nave; i++) {
-        if ((vvec[i].u.x == AKFS_INIT_VALUE_F) ||
-            (vvec[i].u.y == AKFS_INIT_VALUE_F) ||
-            (vvec[i].u.z == AKFS_INIT_VALUE_F)) {
-            break;
-        }
-
-        vave->u.x += vvec[i].u.x;
-        vave->u.y += vvec[i].u.y;
-        vave->u.z += vvec[i].u.z;
-    }
-
-    if (i == 0) {
+    if (vbuf->head == 0) {
         vave->u.x = 0;
         vave->u.y = 0;
         vave->u.z = 0;
+        return AKFS_SUCCESS;
+    }
+
+    if (vbuf->head < (uint32_t)vbuf->nave[win]) {
+        n = (AKFLOAT)vbuf->head;
     } else {
-        vave->u.x /= i;
-        vave->u.y /= i;
-        vave->u.z /= i;
+        n = (AKFLOAT)vbuf->nave[win];
     }
 
+    vave->u.x = vbuf->sum[win].u.x / n;
+    vave->u.y = vbuf->sum[win].u.y / n;
+    vave->u.z = vbuf->sum[win].u.z / n;
+
     return AKFS_SUCCESS;
 }
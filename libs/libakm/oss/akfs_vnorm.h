@@ -20,24 +20,46 @@
 
 #include "akfs_device.h"
 
+/***** Constant definition ****************************************************/
+#define AKFS_VBUF_SIZE  8 /* power of two, longest averaging window */
+#define AKFS_VBUF_WIN   2 /* windows averaged per buffer */
+#define AKFS_VBUF_VEC   0 /* window of the vector output */
+#define AKFS_VBUF_DIR   1 /* window of the direction */
+
+/***** Type declaration *******************************************************/
+/* ring of normalized vectors with a running sum per averaging window */
+typedef struct _AKFS_VBUF {
+    AKFVEC   vec[AKFS_VBUF_SIZE];
+    AKFVEC   sum[AKFS_VBUF_WIN];
+    int16_t  nave[AKFS_VBUF_WIN];
+    uint32_t head; /* number of vectors pushed */
+} AKFS_VBUF;
+
 /***** Prototype of function **************************************************/
 AKLIB_C_API_START
+int16_t AKFS_InitVbuf(
+    AKFS_VBUF     *vbuf,
+    const int16_t nave[AKFS_VBUF_WIN]
+);
+
+void AKFS_VbPush(
+    AKFS_VBUF    *vbuf,
+    const AKFVEC *v
+);
+
 int16_t AKFS_VbNorm(
-    const int16_t ndata,
-    const AKFVEC  vdata[],
     const int16_t nbuf,
+    const AKFVEC  vdata[],
     const AKFVEC  *o,
     const AKFVEC  *s,
     const AKFLOAT tgt,
-    const int16_t nvec,
-    AKFVEC        vvec[]
+    AKFS_VBUF     *vbuf
 );
 
 int16_t AKFS_VbAve(
-    const int16_t nvec,
-    const AKFVEC  vvec[],
-    const int16_t nave,
-    AKFVEC        *vave
+    const AKFS_VBUF *vbuf,
+    const int16_t   win,
+    AKFVEC          *vave
 );
 
 AKLIB_C_API_END
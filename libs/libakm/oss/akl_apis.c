@@ -20,7 +20,9 @@
 #include "akfs_measure.h"
 
 /*! Identify the nv data. */
-#define AKL_NV_MAGIC_NUMBER  (uint32_t)(0xcafecafe)
+#define AKL_NV_MAGIC_NUMBER  (uint32_t)(0xcafecaf2)
+/*! Older nv data, holding the offset only. */
+#define AKL_NV_MAGIC_V1      (uint32_t)(0xcafecafe)
 /*! 1G (= 9.8 m/s^2) in Q16 format. i.e. (9.80665f * 65536) */
 #define ACC_1G_IN_Q16        (642689)
 
@@ -34,6 +36,9 @@
 /*! Convert from SI unit (m/s^2) to AKSC format. */
 #define ACC_CONVERT_FROM_Q16(x)  (int32_t)(((x) * 720) / ACC_1G_IN_Q16)
 
+/*! Longest run of samples handed to the library at once. */
+#define AKL_BATCH_SIZE  16
+
 /******************************************************************************/
 /***** AKM static functions ***************************************************/
 static uint16_t byte_allign(const int32_t sz)
@@ -50,86 +55,75 @@ static uint16_t byte_allign(const int32_t sz)
 }
 
 /*****************************************************************************/
-static int16_t akl_setv_mag(
-    struct AKL_SCL_PRMS          *mem,
-    const struct AKM_SENSOR_DATA *data)
+static int16_t akl_setv(
+    struct AKL_SCL_PRMS   *mem,
+    const AKM_SENSOR_TYPE stype,
+    const AKFVEC          v[],
+    const int16_t         n,
+    const uint32_t        time_us)
 {
-    AKFLOAT mag[3];
+    AKFLOAT gyr[3];
     int     i;
-#ifdef AKL_ARGUMENT_CHECK
-    if (mem == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
 
-    if (data == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-#endif
+    switch (stype) {
+    case AKM_ST_MAG:
+        return AKFS_Set_MAGNETIC_FIELD(mem, v, n);
 
-    for (i = 0; i < 3; i++) {
-        mag[i] = Q16_TO_FLOAT(data->u.v[i]);
-    }
+    case AKM_ST_ACC:
+        return AKFS_Set_ACCELEROMETER(mem, v, n);
 
-    return AKFS_Set_MAGNETIC_FIELD(mem, mag);
-}
+    case AKM_ST_GYR:
 
-/**************************************/
-static int16_t akl_setv_acc(
-    struct AKL_SCL_PRMS          *mem,
-    const struct AKM_SENSOR_DATA *data)
-{
-    AKFLOAT acc[3];
-    int     i;
-#ifdef AKL_ARGUMENT_CHECK
-    if (mem == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
+        /* degree/second to radian/second, never batched */
+        for (i = 0; i < 3; i++) {
+            gyr[i] = DEG2RAD(v[0].v[i]);
+        }
 
-    if (data == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-#endif
+        return AKFS_Set_GYROSCOPE(mem, gyr, time_us);
 
-    for (i = 0; i < 3; i++) {
-        acc[i] = Q16_TO_FLOAT(data->u.v[i]);
+    default:
+        return AKM_ERR_NOT_SUPPORT;
     }
-
-    return AKFS_Set_ACCELEROMETER(mem, acc);
 }
 
-/**************************************/
-static int16_t akl_setv_gyr(
-    struct AKL_SCL_PRMS          *mem,
-    const struct AKM_SENSOR_DATA *data)
+/*****************************************************************************/
+static uint8_t akl_vt_size(const AKM_VECTOR_TYPE vtype)
 {
-    return AKM_ERR_NOT_SUPPORT;
+    switch (vtype) {
+    case AKM_VT_MAG:
+        return AKM_VT_MAG_SIZE;
+
+    case AKM_VT_ACC:
+        return AKM_VT_ACC_SIZE;
+
+    case AKM_VT_GYR:
+        return AKM_VT_GYR_SIZE;
+
+    case AKM_VT_ORI:
+        return AKM_VT_ORI_SIZE;
+
+    case AKM_VT_QUAT:
+        return AKM_VT_QUAT_SIZE;
+
+    case AKM_VT_GEOQUAT:
+        return AKM_VT_GEOQUAT_SIZE;
+
+    default:
+        return 0;
+    }
 }
 
 /*****************************************************************************/
 static int16_t akl_getv_mag(
     struct AKL_SCL_PRMS *mem,
-    int32_t             data[6],
+    AKFLOAT             data[6],
     int32_t             *status)
 {
     int i;
-#ifdef AKL_ARGUMENT_CHECK
-    if (mem == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
 
-    if (data == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-
-    if (status == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-#endif
-
-    /* Convert from SmartCompass to Q16 */
     for (i = 0; i < 3; i++) {
-        data[i] = FLOAT_TO_Q16(mem->fv_hvec.v[i]);
-        data[i + 3] = FLOAT_TO_Q16(mem->fv_ho.v[i]);
+        data[i] = mem->fv_hvec.v[i];
+        data[i + 3] = mem->fv_ho.v[i];
     }
 
     *status = (int32_t)mem->i16_hstatus;
@@ -140,26 +134,13 @@ static int16_t akl_getv_mag(
 /**************************************/
 static int16_t akl_getv_acc(
     struct AKL_SCL_PRMS *mem,
-    int32_t             data[3],
+    AKFLOAT             data[3],
     int32_t             *status)
 {
     int i;
-#ifdef AKL_ARGUMENT_CHECK
-    if (mem == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-
-    if (data == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-
-    if (status == NULL) {
-        return AKM_ERR_INVALID_ARG;
-    }
-#endif
 
     for (i = 0; i < 3; i++) {
-        data[i] = FLOAT_TO_Q16(mem->fv_avec.v[i]);
+        data[i] = mem->fv_avec.v[i];
     }
 
     *status = (int32_t)(3);
@@ -170,35 +151,140 @@ static int16_t akl_getv_acc(
 /**************************************/
 static int16_t akl_getv_gyr(
     struct AKL_SCL_PRMS *mem,
-    int32_t             data[6],
+    AKFLOAT             data[6],
     int32_t             *status)
 {
-    return AKM_ERR_NOT_SUPPORT;
+    int i;
+
+    /* Bias subtracted rate and bias, degree/second */
+    for (i = 0; i < 3; i++) {
+        data[i] = RAD2DEG(mem->s_fusv.gyr.v[i] - mem->s_fusv.bias.v[i]);
+        data[i + 3] = RAD2DEG(mem->s_fusv.bias.v[i]);
+    }
+
+    *status = (AKFS_FusionActive(&mem->s_fusv) == AKFS_SUCCESS) ? 3 : 0;
+
+    return AKM_SUCCESS;
 }
 
 /**************************************/
 static int16_t akl_getv_ori(
     struct AKL_SCL_PRMS *mem,
-    int32_t             data[3],
+    AKFLOAT             data[3],
     int32_t             *status)
 {
-    /* Convert unit */
-    /* from Q6 to Q16 */
-    data[0] = FLOAT_TO_Q16(mem->f_azimuth);
-    data[1] = FLOAT_TO_Q16(mem->f_pitch);
-    data[2] = FLOAT_TO_Q16(mem->f_roll);
+    /* pitch and roll are only needed here */
+    data[0] = mem->f_azimuth;
+    AKFS_Angle(&mem->fv_gdir, &data[1], &data[2]);
 
     *status = (int32_t)(3);
     return AKM_SUCCESS;
 }
 
 /**************************************/
-int16_t akl_getv_quat(
+static int16_t akl_getv_geoquat(
     struct AKL_SCL_PRMS *mem,
-    int32_t             data[4],
+    AKFLOAT             data[4],
     int32_t             *status)
 {
-    return AKM_ERR_NOT_SUPPORT;
+    /* Calculated on request from the averaged vectors */
+    if (AKFS_Quaternion(&mem->s_hvbuf, &mem->s_avbuf, data) != AKFS_SUCCESS) {
+        return AKM_ERROR;
+    }
+
+    /* (x, y, z, w) */
+    *status = (int32_t)mem->i16_hstatus;
+    return AKM_SUCCESS;
+}
+
+/**************************************/
+static int16_t akl_getv_quat(
+    struct AKL_SCL_PRMS *mem,
+    AKFLOAT             data[4],
+    int32_t             *status)
+{
+    int i;
+
+    if (AKFS_FusionActive(&mem->s_fusv) != AKFS_SUCCESS) {
+        return akl_getv_geoquat(mem, data, status);
+    }
+
+    for (i = 0; i < 4; i++) {
+        data[i] = mem->s_fusv.q[i];
+    }
+
+    /* Same hemisphere as the acc/mag quaternion */
+    if (data[3] < 0) {
+        for (i = 0; i < 4; i++) {
+            data[i] = -data[i];
+        }
+    }
+
+    /* (x, y, z, w) */
+    *status = (int32_t)mem->i16_hstatus;
+    return AKM_SUCCESS;
+}
+
+/**************************************/
+static int16_t akl_getv(
+    const AKM_VECTOR_TYPE vtype,
+    struct AKL_SCL_PRMS   *mem,
+    AKFLOAT               *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    switch (vtype) {
+    case AKM_VT_MAG:
+
+        if (AKM_VT_MAG_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_mag(mem, data, status);
+
+    case AKM_VT_ACC:
+
+        if (AKM_VT_ACC_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_acc(mem, data, status);
+
+    case AKM_VT_GYR:
+
+        if (AKM_VT_GYR_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_gyr(mem, data, status);
+
+    case AKM_VT_ORI:
+
+        if (AKM_VT_ORI_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_ori(mem, data, status);
+
+    case AKM_VT_QUAT:
+
+        if (AKM_VT_QUAT_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_quat(mem, data, status);
+
+    case AKM_VT_GEOQUAT:
+
+        if (AKM_VT_GEOQUAT_SIZE > size) {
+            return AKM_ERR_INVALID_ARG;
+        }
+
+        return akl_getv_geoquat(mem, data, status);
+
+    default:
+        return AKM_ERR_NOT_SUPPORT;
+    }
 }
 
 /******************************************************************************/
@@ -265,6 +351,10 @@ int16_t AKL_StartMeasurement(
         if (p_nv->magic == AKL_NV_MAGIC_NUMBER) {
             /* Copy NV data to mem struct. */
             *p_pr = *p_nv;
+        } else if (p_nv->magic == AKL_NV_MAGIC_V1) {
+            /* Keep the offset, its accuracy is unknown. */
+            AKFS_SetDefaultNV(p_pr);
+            p_pr->fv_hsuc_ho = p_nv->fv_hsuc_ho;
         } else {
             AKFS_SetDefaultNV(p_pr);
         }
@@ -287,10 +377,12 @@ int16_t AKL_StopMeasurement(
         return AKM_ERR_INVALID_ARG;
     }
 #endif
+    AKFS_TermMeasure(mem);
+
     p_nv = (struct AKL_NV_PRMS *)nv_data;
     p_pr = mem->ps_nv;
 
-    if (p_nv != NULL) {
+    if ((p_nv != NULL) && (p_pr != NULL)) {
         /* Copy mem data to NV buffer. */
         *p_nv = *p_pr;
         p_nv->magic = AKL_NV_MAGIC_NUMBER;
@@ -305,7 +397,8 @@ int16_t AKL_SetVector(
     const struct AKM_SENSOR_DATA *data,
     const uint8_t                num)
 {
-    uint8_t i;
+    AKFVEC  v[AKL_BATCH_SIZE];
+    uint8_t i, j, n;
     int16_t ret;
 
 #ifdef AKL_ARGUMENT_CHECK
@@ -318,24 +411,68 @@ int16_t AKL_SetVector(
     }
 #endif
 
-    for (i = 0; i < num; i++) {
-        switch (data[i].stype) {
-        case AKM_ST_MAG:
-            ret = akl_setv_mag(mem, &data[i]);
-            break;
+    for (i = 0; i < num; i += n) {
+        /* hand a run of one sensor type over at once, */
+        /* the gyroscope is integrated sample by sample */
+        n = 0;
 
-        case AKM_ST_ACC:
-            ret = akl_setv_acc(mem, &data[i]);
-            break;
+        do {
+            for (j = 0; j < 3; j++) {
+                v[n].v[j] = Q16_TO_FLOAT(data[i + n].u.v[j]);
+            }
 
-        case AKM_ST_GYR:
-            ret = akl_setv_gyr(mem, &data[i]);
-            break;
+            n++;
+        } while ((i + n < num) && (n < AKL_BATCH_SIZE) &&
+                 (data[i + n].stype == data[i].stype) &&
+                 (data[i].stype != AKM_ST_GYR));
 
-        default:
-            ret = AKM_ERR_NOT_SUPPORT;
-            break;
+        ret = akl_setv(mem, data[i].stype, v, n, data[i + n - 1].time_us);
+
+        if (ret != AKM_SUCCESS) {
+            return ret;
         }
+    }
+
+    return AKM_SUCCESS;
+}
+
+/*****************************************************************************/
+int16_t AKL_SetVectorF(
+    struct AKL_SCL_PRMS            *mem,
+    const struct AKM_SENSOR_DATA_F *data,
+    const uint8_t                  num)
+{
+    AKFVEC  v[AKL_BATCH_SIZE];
+    uint8_t i, j, n;
+    int16_t ret;
+
+#ifdef AKL_ARGUMENT_CHECK
+    if (mem == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+
+    if (data == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+#endif
+
+    for (i = 0; i < num; i += n) {
+        /* hand a run of one sensor type over at once, */
+        /* the gyroscope is integrated sample by sample */
+        n = 0;
+
+        do {
+            /* a plain copy, AKFLOAT may be double */
+            for (j = 0; j < 3; j++) {
+                v[n].v[j] = data[i + n].u.v[j];
+            }
+
+            n++;
+        } while ((i + n < num) && (n < AKL_BATCH_SIZE) &&
+                 (data[i + n].stype == data[i].stype) &&
+                 (data[i].stype != AKM_ST_GYR));
+
+        ret = akl_setv(mem, data[i].stype, v, n, data[i + n - 1].time_us);
 
         if (ret != AKM_SUCCESS) {
             return ret;
@@ -360,18 +497,23 @@ int16_t AKL_CalcFusion(struct AKL_SCL_PRMS *mem)
     /* avbuf[in] : Android coordinate, sensitivity adjusted, */
     /*			   offset subtracted. */
     /* azimuth[out]: Android coordinate and unit (degree). */
-    /* pitch  [out]: Android coordinate and unit (degree). */
-    /* roll   [out]: Android coordinate and unit (degree). */
+    /* gdir   [out]: Android coordinate, normalized gravity, */
+    /*			   pitch and roll are derived from it on output. */
+    /* With a gyroscope the fused attitude is used instead. */
+    if (AKFS_FusionActive(&mem->s_fusv) == AKFS_SUCCESS) {
+        AKFS_DirectionQuat(
+            mem->s_fusv.q,
+            &mem->f_azimuth,
+            &mem->fv_gdir
+        );
+        return AKM_SUCCESS;
+    }
+
     ret = AKFS_Direction(
-            AKFS_HDATA_SIZE,
-            mem->fva_hvbuf,
-            AKFS_HNAVE_D,
-            AKFS_ADATA_SIZE,
-            mem->fva_avbuf,
-            AKFS_ANAVE_D,
+            &mem->s_hvbuf,
+            &mem->s_avbuf,
             &mem->f_azimuth,
-            &mem->f_pitch,
-            &mem->f_roll
+            &mem->fv_gdir
         );
 
     if (ret == AKFS_ERROR) {
@@ -389,50 +531,90 @@ int16_t AKL_GetVector(
     uint8_t               size,
     int32_t               *status)
 {
-    switch (vtype) {
-    case AKM_VT_MAG:
+    AKFLOAT v[AKM_VT_MAG_SIZE]; /* the largest vector */
+    int16_t ret;
+    uint8_t n;
+    uint8_t i;
 
-        if (AKM_VT_MAG_SIZE > size) {
-            return AKM_ERR_INVALID_ARG;
-        }
+#ifdef AKL_ARGUMENT_CHECK
+    if (mem == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
-        return akl_getv_mag(mem, data, status);
+    if (data == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
-    case AKM_VT_ACC:
+    if (status == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+#endif
 
-        if (AKM_VT_ACC_SIZE > size) {
-            return AKM_ERR_INVALID_ARG;
-        }
+    /* only the vector itself is written, as before */
+    n = akl_vt_size(vtype);
 
-        return akl_getv_acc(mem, data, status);
+    if (n > size) {
+        n = size;
+    }
 
-    case AKM_VT_GYR:
+    ret = akl_getv(vtype, mem, v, n, status);
 
-        if (AKM_VT_GYR_SIZE > size) {
-            return AKM_ERR_INVALID_ARG;
-        }
+    if (ret != AKM_SUCCESS) {
+        return ret;
+    }
 
-        return akl_getv_gyr(mem, data, status);
+    /* Convert from SmartCompass to Q16 */
+    for (i = 0; i < n; i++) {
+        data[i] = FLOAT_TO_Q16(v[i]);
+    }
 
-    case AKM_VT_ORI:
+    return AKM_SUCCESS;
+}
 
-        if (AKM_VT_ORI_SIZE > size) {
-            return AKM_ERR_INVALID_ARG;
-        }
+/*****************************************************************************/
+int16_t AKL_GetVectorF(
+    const AKM_VECTOR_TYPE vtype,
+    struct AKL_SCL_PRMS   *mem,
+    float                 *data,
+    uint8_t               size,
+    int32_t               *status)
+{
+    AKFLOAT v[AKM_VT_MAG_SIZE]; /* the largest vector */
+    int16_t ret;
+    uint8_t n;
+    uint8_t i;
 
-        return akl_getv_ori(mem, data, status);
+#ifdef AKL_ARGUMENT_CHECK
+    if (mem == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
-    case AKM_VT_QUAT:
+    if (data == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
 
-        if (AKM_VT_QUAT_SIZE > size) {
-            return AKM_ERR_INVALID_ARG;
-        }
+    if (status == NULL) {
+        return AKM_ERR_INVALID_ARG;
+    }
+#endif
 
-        return akl_getv_quat(mem, data, status);
+    n = akl_vt_size(vtype);
 
-    default:
-        return AKM_ERR_NOT_SUPPORT;
+    if (n > size) {
+        n = size;
+    }
+
+    ret = akl_getv(vtype, mem, v, n, status);
+
+    if (ret != AKM_SUCCESS) {
+        return ret;
     }
+
+    for (i = 0; i < n; i++) {
+        data[i] = (float)v[i];
+    }
+
+    return AKM_SUCCESS;
 }
 
 /*****************************************************************************/
@@ -450,6 +632,7 @@ void AKL_GetLibraryInfo(struct AKL_LIBRARY_INFO *info)
 void AKL_ForceReCalibration(struct AKL_SCL_PRMS *mem)
 {
     mem->i16_hstatus = 0;
+    mem->f_hwr = 0;
 }
 
 /*****************************************************************************/
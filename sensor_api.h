@@ -34,6 +34,9 @@ struct sensor_api_t {
 	int (*set_delay)(struct sensor_api_t *s, int64_t ns);
 	void (*close)(struct sensor_api_t *s);
 	void (*data)(struct sensor_api_t *s, struct sensor_data_t *sd);
+	/* optional, takes a run of samples in place of one data call each */
+	void (*data_batch)(struct sensor_api_t *s, struct sensor_data_t *sd,
+			   int n);
 };
 
 #endif
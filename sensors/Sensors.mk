@@ -3,13 +3,16 @@
 #
 $(SOMC_CFG_SENSORS_ACCEL_BMA150_INPUT)-files += bma150_input.c
 $(SOMC_CFG_SENSORS_ACCEL_BMA150_INPUT)-cflags += -DACC_BMA150_INPUT
+$(SOMC_CFG_SENSORS_ACCEL_BMA150_INPUT)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_ACCEL_BMA250_INPUT)-files += bma250_input.c
 $(SOMC_CFG_SENSORS_ACCEL_BMA250_INPUT)-cflags += -DACC_BMA250_INPUT
+$(SOMC_CFG_SENSORS_ACCEL_BMA250_INPUT)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_ACCEL_BMA250NA_INPUT)-files += bma250na_input.c \
 					wrappers/bma250na_input_accelerometer.c
 $(SOMC_CFG_SENSORS_ACCEL_BMA250NA_INPUT)-cflags += -DACC_BMA250_INPUT
+$(SOMC_CFG_SENSORS_ACCEL_BMA250NA_INPUT)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_COMPASS_LSM303DLH)-cflags += -DST_LSM303DLH
 $(SOMC_CFG_SENSORS_COMPASS_LSM303DLH)-var-compass-lsm303dlh = yes
@@ -121,6 +124,7 @@ $(SOMC_CFG_SENSORS_SYSTEM_WIDE_ALS)-files += sys_als.c
 $(SOMC_CFG_SENSORS_SYSTEM_WIDE_ALS)-c-includes += $(DASH_ROOT)/libs/lights
 $(SOMC_CFG_SENSORS_SYSTEM_WIDE_ALS)-shared-libs += liblights-core
 $(SOMC_CFG_SENSORS_SYSTEM_WIDE_ALS)-var-set-light-range = yes
+$(SOMC_CFG_SENSORS_SYSTEM_WIDE_ALS)-var-evdev = yes
 
 $(yes-var-set-light-range)-cflags += \
 	-DLIGHT_RANGE=$(if $(SOMC_CFG_SENSORS_LIGHT_RANGE),$(SOMC_CFG_SENSORS_LIGHT_RANGE),900)
@@ -130,23 +134,30 @@ $(yes-var-set-light-range)-cflags += \
 #
 $(SOMC_CFG_SENSORS_PROXIMITY_APDS9700)-files  += apds970x.c
 $(SOMC_CFG_SENSORS_PROXIMITY_APDS9700)-cflags += -DPROXIMITY_SENSOR_NAME="\"APDS9700 Proximity\""
+$(SOMC_CFG_SENSORS_PROXIMITY_APDS9700)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_PROXIMITY_APDS9702)-files  += apds970x.c
 $(SOMC_CFG_SENSORS_PROXIMITY_APDS9702)-cflags += -DPROXIMITY_SENSOR_NAME="\"APDS9702 Proximity\""
+$(SOMC_CFG_SENSORS_PROXIMITY_APDS9702)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_PROXIMITY_SHARP_GP2)-files += sharp_gp2.c
+$(SOMC_CFG_SENSORS_PROXIMITY_SHARP_GP2)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_PROXIMITY_NOA3402)-files  += noa3402.c
 $(SOMC_CFG_SENSORS_PROXIMITY_NOA3402)-cflags += -DPROXIMITY_PATH="\"$(SOMC_CFG_SENSORS_PROXIMITY_NOA3402_PATH)\""
+$(SOMC_CFG_SENSORS_PROXIMITY_NOA3402)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_PROXIMITY_TLS2772)-files += tsl2772.c
+$(SOMC_CFG_SENSORS_PROXIMITY_TLS2772)-var-evdev = yes
 
 #
 # Pressure sensors
 #
 $(SOMC_CFG_SENSORS_PRESSURE_BMP180)-files += bmp180_input.c
+$(SOMC_CFG_SENSORS_PRESSURE_BMP180)-var-evdev = yes
 
 $(SOMC_CFG_SENSORS_PRESSURE_LPS331AP)-files += lps331ap_input.c
+$(SOMC_CFG_SENSORS_PRESSURE_LPS331AP)-var-evdev = yes
 
 #
 # Gyro sensors
@@ -192,8 +203,12 @@ endif
 # AKM sensor solution
 #
 $(SOMC_CFG_LIBAKM_LIBOSS)-files += wrappers/akmoss_sensors.c
+ifeq ($(SOMC_CFG_SENSORS_GYRO_L3G4200D),yes)
+$(SOMC_CFG_LIBAKM_LIBOSS)-cflags += -DAKMOSS_GYRO
+endif
 
 #
 # Shared files
 #
 $(yes-var-xyz)-files += sensor_xyz.c
+$(yes-var-evdev)-files += sensor_evdev.c
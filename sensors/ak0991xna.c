@@ -22,10 +22,12 @@
 #include <linux/input.h>
 #include <linux/ioctl.h>
 #include <pthread.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "sensor_util.h"
 #include "sensor_xyz.h"
@@ -35,6 +37,8 @@
 #include "sensors_list.h"
 #include "sensors_log.h"
 #include "sensors_select.h"
+#include "sensors_stats.h"
+#include "sensors_trace.h"
 #include "sensors_wrapper.h"
 
 #define SETTING_FILE_NAME  "/data/misc/akm_set.bin"
@@ -60,6 +64,10 @@
 #define AKM_MAX_INTERVAL        INT_MAX
 #define AKM_USE_CONTINUOUS      1
 
+/* frames decoded by one read, each is status, x, y, z and EV_SYN */
+#define AK0991X_BATCH           16
+#define AK0991X_FRAME_EVENTS    5
+
 static int ak0991x_init(
     struct sensor_api_t *s_api
 );
@@ -112,141 +120,260 @@ static struct sensor_desc ak0991xna_magnetic = {
     .applied_delay_ms = 0,
 };
 
-static int ak0991x_start(void)
+/* NV data stays resident between activations. Only the flush thread
+ * touches the setting file, it writes a temporary file and renames it
+ * over the old one so a crash never leaves a torn file behind. */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    pthread_t       thread;
+    uint8_t         *cur;    /* latest data from the library */
+    uint8_t         *saved;  /* what the setting file holds */
+    uint16_t        sz;
+    int             loaded;  /* setting file has been read */
+    int             valid;   /* cur holds usable data */
+    int             dirty;
+    int             running;
+} nv = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int ak0991x_nv_write(const uint8_t *buf, uint16_t sz)
 {
-    uint16_t            sz;
-    size_t              rsz;
-    int16_t             ret = -1;
-    int16_t             needpdc = 0;
-    uint8_t             *buf = NULL;
-    FILE                *fp = NULL;
-    struct AKL_SCL_PRMS *mem;
+    size_t wsz;
+    FILE   *fp;
+    int    ret = -1;
 
-    /* open setting file for read. */
-    fp = fopen(SETTING_FILE_NAME, "rb");
+    fp = fopen(SETTING_FILE_NAME ".tmp", "wb");
 
     if (fp == NULL) {
-        ALOGW("%s: file '%s' cannot open (%s)",
-              __func__, SETTING_FILE_NAME, strerror(errno));
-        /* When AKL_StartMeasurement is called with buf=NULL, */
-        /*  default parameter will be set */
-        needpdc = 1;
-    } else {
-        /* malloc parameter data area */
-        sz = AKL_GetNVdataSize(AKM_CUSTOM_NUM_FORM);
-        buf = (uint8_t *)malloc(sz);
-
-        if (!buf) {
-            ALOGE("%s: malloc failed.", __func__);
-            goto exit;
-        }
-
-        /* read setting */
-        rsz = fread(buf, sizeof(uint8_t), sz, fp);
-
-        if (rsz != sz) {
-            ALOGE("%s: Request %d bytes, but actually %d bytes read.",
-                  __func__, sz, rsz);
-            goto exit;
-        }
+        ALOGE("%s: file '%s' cannot open (%s)",
+              __func__, SETTING_FILE_NAME ".tmp", strerror(errno));
+        return -1;
     }
 
-    /* library API */
-    mem = AKL_DASH_Lock();
+    wsz = fwrite(buf, sizeof(uint8_t), sz, fp);
 
-    if (AKL_StartMeasurement(mem, buf) != AKM_SUCCESS) {
-        ALOGE("%s: failed to start library.", __func__);
-        AKL_DASH_Unlock();
+    if (wsz != sz) {
+        ALOGE("%s: Request %d bytes, but actually %d bytes wrote.",
+              __func__, sz, wsz);
         goto exit;
     }
 
-    AKL_DASH_Unlock();
-
-    /* set PDC */
-    if (needpdc) {
-        /* TODO: read pdc parameter */
-        /* AKL_SetPDC() */
+    if (fflush(fp) || fsync(fileno(fp))) {
+        ALOGE("%s: sync failed (%s)", __func__, strerror(errno));
+        goto exit;
     }
 
-    /* Success */
     ret = 0;
-    ALOGI("%s: finished successfully.", __func__);
 
 exit:
+    fclose(fp);
 
-    if (fp) {
-        fclose(fp);
+    if (!ret && rename(SETTING_FILE_NAME ".tmp", SETTING_FILE_NAME)) {
+        ALOGE("%s: rename failed (%s)", __func__, strerror(errno));
+        ret = -1;
     }
 
-    if (!buf) {
-        free(buf);
+    if (ret) {
+        unlink(SETTING_FILE_NAME ".tmp");
     }
 
     return ret;
 }
 
-static int ak0991x_stop(void)
+static void *ak0991x_nv_flush(void *arg)
 {
-    uint16_t            sz;
-    size_t              wsz;
-    int16_t             ret = -1;
-    uint8_t             *buf = NULL;
-    FILE                *fp = NULL;
-    struct AKL_SCL_PRMS *mem;
+    uint8_t *buf = arg;
+
+    pthread_mutex_lock(&nv.lock);
 
-    /* malloc parameter data area */
-    sz = AKL_GetNVdataSize(AKM_CUSTOM_NUM_FORM);
-    buf = (uint8_t *)malloc(sz);
+    for (;;) {
+        while (nv.running && !nv.dirty) {
+            pthread_cond_wait(&nv.cond, &nv.lock);
+        }
+
+        if (!nv.dirty) {
+            break;
+        }
+
+        memcpy(buf, nv.cur, nv.sz);
+        nv.dirty = 0;
+        pthread_mutex_unlock(&nv.lock);
 
-    if (!buf) {
+        if (!ak0991x_nv_write(buf, nv.sz)) {
+            pthread_mutex_lock(&nv.lock);
+            memcpy(nv.saved, buf, nv.sz);
+            ALOGI("%s: setting file updated.", __func__);
+        } else {
+            pthread_mutex_lock(&nv.lock);
+        }
+    }
+
+    pthread_mutex_unlock(&nv.lock);
+    free(buf);
+
+    return NULL;
+}
+
+static int ak0991x_nv_init(void)
+{
+    uint8_t *buf;
+
+    nv.sz = AKL_GetNVdataSize(AKM_CUSTOM_NUM_FORM);
+    nv.cur = (uint8_t *)malloc(nv.sz);
+    nv.saved = (uint8_t *)malloc(nv.sz);
+    buf = (uint8_t *)malloc(nv.sz);
+
+    if (!nv.cur || !nv.saved || !buf) {
         ALOGE("%s: malloc failed.", __func__);
-        return -1;
+        goto err;
     }
 
-    /* call stop */
-    mem = AKL_DASH_Lock();
+    nv.loaded = 0;
+    nv.valid = 0;
+    nv.dirty = 0;
+    nv.running = 1;
 
-    if (AKL_StopMeasurement(mem, buf) != AKM_SUCCESS) {
-        ALOGE("%s: failed to stop library.", __func__);
-        AKL_DASH_Unlock();
-        goto exit;
+    if (pthread_create(&nv.thread, NULL, ak0991x_nv_flush, buf)) {
+        ALOGE("%s: failed to create flush thread.", __func__);
+        goto err;
     }
 
-    AKL_DASH_Unlock();
+    return 0;
+
+err:
+    free(buf);
+    free(nv.saved);
+    free(nv.cur);
+    nv.saved = nv.cur = NULL;
+    return -1;
+}
 
-    /* open setting file for write. */
-    fp = fopen(SETTING_FILE_NAME, "wb");
+static void ak0991x_nv_deinit(void)
+{
+    if (!nv.cur) {
+        return;
+    }
+
+    /* the thread writes out anything pending before it leaves */
+    pthread_mutex_lock(&nv.lock);
+    nv.running = 0;
+    pthread_cond_signal(&nv.cond);
+    pthread_mutex_unlock(&nv.lock);
+    pthread_join(nv.thread, NULL);
+
+    free(nv.saved);
+    free(nv.cur);
+    nv.saved = nv.cur = NULL;
+}
+
+static void ak0991x_nv_load(void)
+{
+    size_t rsz;
+    FILE   *fp;
+
+    /* open setting file for read. */
+    fp = fopen(SETTING_FILE_NAME, "rb");
 
     if (fp == NULL) {
-        ALOGE("%s: file '%s' cannot open (%s)",
+        ALOGW("%s: file '%s' cannot open (%s)",
               __func__, SETTING_FILE_NAME, strerror(errno));
-        goto exit;
+        return;
     }
 
-    /* write setting */
-    wsz = fwrite(buf, sizeof(uint8_t), sz, fp);
+    /* read setting */
+    rsz = fread(nv.cur, sizeof(uint8_t), nv.sz, fp);
+    fclose(fp);
 
-    if (wsz != sz) {
-        ALOGE("%s: Request %d bytes, but actually %d bytes wrote.",
-              __func__, sz, wsz);
-        goto exit;
+    if (rsz == 0) {
+        ALOGE("%s: Request %d bytes, but nothing read.", __func__, nv.sz);
+        return;
+    }
+
+    /* a file written by an older library is shorter, the library tells
+     * the formats apart by their magic and ignores the missing tail */
+    if (rsz != nv.sz) {
+        ALOGW("%s: Request %d bytes, but actually %d bytes read.",
+              __func__, nv.sz, rsz);
+        memset(nv.cur + rsz, 0, nv.sz - rsz);
+    }
+
+    memcpy(nv.saved, nv.cur, nv.sz);
+    nv.valid = 1;
+}
+
+static int ak0991x_start(void)
+{
+    int16_t             ret;
+    int16_t             needpdc;
+    struct AKL_SCL_PRMS *mem;
+
+    pthread_mutex_lock(&nv.lock);
+
+    /* the file is read once, later activations reuse the resident copy */
+    if (!nv.loaded) {
+        ak0991x_nv_load();
+        nv.loaded = 1;
+    }
+
+    /* When AKL_StartMeasurement is called with buf=NULL, */
+    /*  default parameter will be set */
+    needpdc = !nv.valid;
+
+    /* library API */
+    mem = AKL_DASH_Lock();
+    ret = AKL_StartMeasurement(mem, nv.valid ? nv.cur : NULL);
+    AKL_DASH_Unlock();
+    pthread_mutex_unlock(&nv.lock);
+
+    if (ret != AKM_SUCCESS) {
+        ALOGE("%s: failed to start library.", __func__);
+        return -1;
+    }
+
+    /* set PDC */
+    if (needpdc) {
+        /* TODO: read pdc parameter */
+        /* AKL_SetPDC() */
     }
 
-    /* Success */
-    ret = 0;
     ALOGI("%s: finished successfully.", __func__);
 
-exit:
+    return 0;
+}
+
+static int ak0991x_stop(void)
+{
+    int16_t             ret;
+    struct AKL_SCL_PRMS *mem;
+
+    pthread_mutex_lock(&nv.lock);
+
+    /* call stop */
+    mem = AKL_DASH_Lock();
+    ret = AKL_StopMeasurement(mem, nv.cur);
+    AKL_DASH_Unlock();
 
-    if (fp) {
-        fclose(fp);
+    if (ret != AKM_SUCCESS) {
+        ALOGE("%s: failed to stop library.", __func__);
+        pthread_mutex_unlock(&nv.lock);
+        return -1;
     }
 
-    if (!buf) {
-        free(buf);
+    /* leave the disk alone unless the calibration really moved */
+    if (!nv.valid || AKL_DASH_NVChanged(nv.saved, nv.cur, nv.sz)) {
+        nv.dirty = 1;
+        pthread_cond_signal(&nv.cond);
     }
 
-    return ret;
+    nv.valid = 1;
+    pthread_mutex_unlock(&nv.lock);
+
+    ALOGI("%s: finished successfully.", __func__);
+
+    return 0;
 }
 
 static int ak0991x_set_interval(
@@ -314,6 +441,11 @@ static int ak0991x_init(struct sensor_api_t *s_api)
         goto err1;
     }
 
+    if (ak0991x_nv_init()) {
+        ret = -1;
+        goto err1;
+    }
+
     sensors_sysfs_init(&d->sysfs, d->input_name, SYSFS_TYPE_INPUT_DEV);
     sensors_select_init(&d->select_worker, ak0991x_read, d, -1);
 
@@ -357,6 +489,7 @@ static int ak0991x_activate(
             goto exit;
         }
 
+        d->kernel_clock = input_set_kernel_clock(fd);
         d->select_worker.set_fd(&d->select_worker, fd);
         d->select_worker.resume(&d->select_worker);
     } else if (!enable && (fd > 0)) {
@@ -420,63 +553,103 @@ static void ak0991x_close(struct sensor_api_t *s)
     struct sensor_desc *d = container_of(s, struct sensor_desc, api);
 
     d->select_worker.destroy(&d->select_worker);
+    ak0991x_nv_deinit();
     AKL_DASH_Deinit();
 }
 
-static void *ak0991x_read(void *arg)
+/* hand the frames of one read to the library and the wrappers at once */
+static void ak0991x_flush(
+    struct sensor_desc       *d,
+    struct sensor_data_t     *sd,
+    struct AKM_SENSOR_DATA_F *akm_data,
+    int                      n)
 {
-    struct input_event     evbuf[10];
-    struct input_event     *event;
-    struct sensor_desc     *d = arg;
-    int                    fd = d->select_worker.get_fd(&d->select_worker);
-    int                    n;
-    int                    i;
-    struct sensor_data_t   sd;
-    static int             status = SENSOR_STATUS_ACCURACY_HIGH;
-    struct AKM_SENSOR_DATA akm_data;
-    struct AKL_SCL_PRMS    *mem;
-    int                    err;
+    struct AKL_SCL_PRMS *mem;
+    int64_t             now;
+    int                 err;
+    int                 i;
+
+    if (!n) {
+        return;
+    }
+
+    if (d->kernel_clock) {
+        now = get_current_nano_time();
+
+        for (i = 0; i < n; i++) {
+            sensors_stats_latency(d->sensor.handle, STATS_READ,
+                                  now - sd[i].timestamp);
+        }
+    }
+
+    /* set data to library */
+    mem = AKL_DASH_Lock();
+    err = AKL_SetVectorF(mem, akm_data, n);
+    AKL_DASH_Publish(mem, AKM_VT_MAG);
+    AKL_DASH_Unlock();
 
+    if (err && (AKM_ERR_NOT_SUPPORT != err)) {
+        ALOGE("%s,%d: AKL_SetVector Error (%d)!",
+              __func__, __LINE__, err);
+    }
+
+    sensors_wrapper_data_batch(sd, n);
+}
+
+static void *ak0991x_read(void *arg)
+{
+    struct input_event       evbuf[AK0991X_BATCH * AK0991X_FRAME_EVENTS];
+    struct input_event       *event;
+    struct sensor_desc       *d = arg;
+    int                      fd = d->select_worker.get_fd(&d->select_worker);
+    int                      n;
+    int                      i;
+    struct sensor_data_t     sd[AK0991X_BATCH];
+    int                      raw[AK0991X_BATCH][3];
+    static int               status = SENSOR_STATUS_ACCURACY_HIGH;
+    struct AKM_SENSOR_DATA_F akm_data[AK0991X_BATCH];
+    int                      frames = 0;
+
+    TRACE_BEGIN("evdev_read");
     n = read(fd, evbuf, sizeof(evbuf));
+    TRACE_END();
 
     if (n < 0) {
         ALOGE("%s: read error from fd %d, errno %d", __func__, fd, errno);
         goto exit;
     }
 
+    TRACE_BEGIN("ak0991x_parse");
     n = n / sizeof(evbuf[0]);
 
     for (i = 0; i < n; i++) {
         event = evbuf + i;
 
         if (event->type == EV_SYN) {
-            memset(&sd, 0, sizeof(sd));
-            sd.sensor = &d->sensor;
-            sd.data = d->data;
-            sd.scale = 1.0f / 65536.0f;
-            sd.status = status;
-            sd.timestamp = get_current_nano_time();
-            sd.delay = d->applied_delay_ms;
-
-            akm_data.u.s.x = sd.data[AXIS_X];
-            akm_data.u.s.y = sd.data[AXIS_Y];
-            akm_data.u.s.z = sd.data[AXIS_Z];
-            akm_data.stype = AKM_ST_MAG;
-            akm_data.time_us = sd.timestamp / 1000;
+            memcpy(raw[frames], d->raw, sizeof(raw[frames]));
+            memset(&sd[frames], 0, sizeof(sd[frames]));
+            sd[frames].sensor = &d->sensor;
+            sd[frames].data = raw[frames];
+            sd[frames].scale = 1.0f / 65536.0f;
+            sd[frames].status = status;
+            sd[frames].timestamp = d->kernel_clock ?
+                                   input_event_time(event) :
+                                   get_current_nano_time();
+            sd[frames].delay = d->applied_delay_ms;
+
+            akm_data[frames].u.s.x = raw[frames][AXIS_X] * sd[frames].scale;
+            akm_data[frames].u.s.y = raw[frames][AXIS_Y] * sd[frames].scale;
+            akm_data[frames].u.s.z = raw[frames][AXIS_Z] * sd[frames].scale;
+            akm_data[frames].stype = AKM_ST_MAG;
+            akm_data[frames].time_us = sd[frames].timestamp / 1000;
             /* ST1 value is not reported from driver. Use dummy data. */
-            akm_data.status[0] = 1;
-            akm_data.status[1] = sd.status;
-            /* set data to library */
-            mem = AKL_DASH_Lock();
-            err = AKL_SetVector(mem, &akm_data, 1);
-            AKL_DASH_Unlock();
-
-            if (err && (AKM_ERR_NOT_SUPPORT != err)) {
-                ALOGE("%s,%d: AKL_SetVector Error (%d)!",
-                      __func__, __LINE__, err);
-            }
+            akm_data[frames].status[0] = 1;
+            akm_data[frames].status[1] = status;
 
-            sensors_wrapper_data(&sd);
+            if (++frames == AK0991X_BATCH) {
+                ak0991x_flush(d, sd, akm_data, frames);
+                frames = 0;
+            }
         }
 
         if (event->type != EV_MSC) {
@@ -489,19 +662,22 @@ static void *ak0991x_read(void *arg)
             break;
 
         case EVENT_CODE_MAGV_X:
-            d->data[0] = event->value;
+            d->raw[0] = event->value;
             break;
 
         case EVENT_CODE_MAGV_Y:
-            d->data[1] = event->value;
+            d->raw[1] = event->value;
             break;
 
         case EVENT_CODE_MAGV_Z:
-            d->data[2] = event->value;
+            d->raw[2] = event->value;
             break;
         }
     }
 
+    ak0991x_flush(d, sd, akm_data, frames);
+    TRACE_END();
+
 exit:
     return NULL;
 }
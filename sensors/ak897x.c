@@ -90,6 +90,7 @@ struct ak897x_sensor_composition {
 	struct sensor_desc magnetic;
 	char *input_name;
 	struct sensors_select_t select_worker;
+	struct sensors_config_notifier config_notifier;
 	pthread_mutex_t lock;
 	int acc_handle;
 	int (*request_acc_delay)(int *handle, int64_t ns);
@@ -153,6 +154,18 @@ static void ak897x_read_sensor_map(struct sensor_desc *d)
 	     d->sign[AXIS_X], d->sign[AXIS_Y], d->sign[AXIS_Z]);
 }
 
+static void ak897x_reload_sensor_map(struct sensors_config_notifier *n)
+{
+	struct ak897x_sensor_composition *sc = container_of(n,
+			struct ak897x_sensor_composition, config_notifier);
+
+	pthread_mutex_lock(&sc->lock);
+	ak897x_read_sensor_map(&sc->orientation);
+	ak897x_read_sensor_map(&sc->orientation_raw);
+	ak897x_read_sensor_map(&sc->magnetic);
+	pthread_mutex_unlock(&sc->lock);
+}
+
 static int ak897x_set_delay(struct sensor_api_t *s, int64_t ns)
 {
 	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
@@ -207,6 +220,8 @@ static int ak897x_init(struct sensor_api_t *s_api)
 	ak897x_read_sensor_map(&sc->orientation);
 	ak897x_read_sensor_map(&sc->orientation_raw);
 	ak897x_read_sensor_map(&sc->magnetic);
+	sc->config_notifier.reload = ak897x_reload_sensor_map;
+	sensors_config_register_notifier(&sc->config_notifier);
 	sensors_select_init(&sc->select_worker, ak897x_read, sc, -1);
 	return 0;
 }
@@ -179,7 +179,7 @@ static void *ak897x_read(void *arg)
 			memset(&sd, 0, sizeof(sd));
 			sd.sensor = &d->sensor;
 			sd.timestamp = get_current_nano_time();
-			sd.data = d->data;
+			sd.data = d->raw;
 			sd.delay = d->applied_delay_ms;
 			sd.status = status;
 			sensors_wrapper_data(&sd);
@@ -191,13 +191,13 @@ static void *ak897x_read(void *arg)
 				status = event->value;
 				break;
 			case EVENT_CODE_MAGV_X:
-				d->data[0] = event->value;
+				d->raw[0] = event->value;
 				break;
 			case EVENT_CODE_MAGV_Y:
-				d->data[1] = event->value;
+				d->raw[1] = event->value;
 				break;
 			case EVENT_CODE_MAGV_Z:
-				d->data[2] = event->value;
+				d->raw[2] = event->value;
 				break;
 		}
 	}
@@ -17,57 +17,60 @@
 #define LOG_TAG "DASH - proximity"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
-#include "sensors_log.h"
+#include <unistd.h>
 #include <fcntl.h>
-#include <linux/input.h>
 #include <errno.h>
-#include "sensors_list.h"
-#include "sensors_fifo.h"
-#include "sensors_select.h"
-#include "sensor_util.h"
+#include <sys/ioctl.h>
+#include "sensors_log.h"
 #include "sensors_id.h"
+#include "sensor_evdev.h"
 
 #define PROXIMITY_DEV_NAME "apds9702"
 #define THRESH_DEFAULT   5
 #define PATH_SIZE      100
 #define UN_INIT         -1
 
-static int apds9700_init(struct sensor_api_t *s);
-static int apds9700_activate(struct sensor_api_t *s, int enable);
-static int apds9700_set_delay(struct sensor_api_t *s, int64_t ns);
-static void apds9700_close(struct sensor_api_t *s);
-static void *apds9700_read(void *arg);
+static int apds9700_enable(struct evdev_desc *evdev, int fd, int enable);
+static void apds9700_changed(struct evdev_desc *evdev, int value, int raw);
 
 struct sensor_desc {
-	struct sensors_select_t select_worker;
-	struct sensor_t sensor;
-	struct sensor_api_t api;
-
-	float distance;
-	int64_t delay;
+	struct evdev_desc evdev;
 
 	int th_det;
 	int th_not_det;
 	char th_path[PATH_SIZE];
 };
 
+static const struct evdev_field apds9700_fields[] = {
+	{ EV_MSC, MSC_RAW, 0, EVDEV_FIELD_BOOL },
+	{ EV_ABS, ABS_DISTANCE, 0, EVDEV_FIELD_BOOL },
+};
+
 static struct sensor_desc apds970x = {
-	.sensor = {
-		.name = PROXIMITY_SENSOR_NAME,
-		.vendor = "Sony",
-		.version = sizeof(sensors_event_t),
-		.handle = SENSOR_PROXIMITY_HANDLE,
-		.type = SENSOR_TYPE_PROXIMITY,
-		.maxRange = 1.0,
-		.resolution = 1.0,
-		.power = 2
-	},
-	.api = {
-		.init = apds9700_init,
-		.activate = apds9700_activate,
-		.set_delay = apds9700_set_delay,
-		.close = apds9700_close
+	.evdev = {
+		.sensor = {
+			.name = PROXIMITY_SENSOR_NAME,
+			.vendor = "Sony",
+			.version = sizeof(sensors_event_t),
+			.handle = SENSOR_PROXIMITY_HANDLE,
+			.type = SENSOR_TYPE_PROXIMITY,
+			.maxRange = 1.0,
+			.resolution = 1.0,
+			.power = 2
+		},
+		.api = {
+			.init = sensor_evdev_init,
+			.activate = sensor_evdev_activate,
+			.set_delay = sensor_evdev_set_delay,
+			.close = sensor_evdev_close
+		},
+		.input_name = PROXIMITY_DEV_NAME,
+		EVDEV_FIELDS(apds9700_fields),
+		.size = 1,
+		.enable = apds9700_enable,
+		.changed = apds9700_changed,
 	},
 	.th_not_det = UN_INIT,
 };
@@ -126,7 +129,8 @@ static void apds9700_change_threshold(struct sensor_desc *d)
 		ALOGE("%s: opening %s for write failed (%s)\n",
 		     __func__, d->th_path, strerror(errno));
 	} else {
-		int th_new = (d->distance == 0.0) ? d->th_det : d->th_not_det;
+		int th_new = (d->evdev.value[0] == 0.0) ? d->th_det :
+							   d->th_not_det;
 		char th_new_c[10];
 		unsigned int cnt = snprintf(th_new_c, sizeof(th_new_c), "%d",
 					th_new);
@@ -137,120 +141,34 @@ static void apds9700_change_threshold(struct sensor_desc *d)
 	}
 }
 
-static int apds9700_init(struct sensor_api_t *s)
+static int apds9700_enable(struct evdev_desc *evdev, int fd, int enable)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd;
-
-	/* check for availablity */
-	fd = open_input_dev_by_name(PROXIMITY_DEV_NAME, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
-		ALOGE("%s: unable to find %s input device!\n", __func__,
-			PROXIMITY_DEV_NAME);
-		return fd;
-	}
-	close(fd);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
 
-	sensors_select_init(&d->select_worker, apds9700_read, s, -1);
-	return 0;
-}
-
-static int apds9700_activate(struct sensor_api_t *s, int enable)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
-
-	if (enable && (fd < 0)) {
-		fd = open_input_dev_by_name(PROXIMITY_DEV_NAME,
-			O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			ALOGE("%s: failed to open input dev %s\n", __func__,
-				PROXIMITY_DEV_NAME);
-			return fd;
-		}
+	if (enable) {
 #ifdef EVIOCSSUSPENDBLOCK
 		if (ioctl(fd, EVIOCSSUSPENDBLOCK, 1))
 			ALOGW("%s: unable to enable wake locks\n", __func__);
 #endif
 		apds9700_init_threshold_members(d, fd);
-		d->select_worker.set_fd(&d->select_worker, fd);
-		d->select_worker.resume(&d->select_worker);
-	} else if (!enable && (fd > 0)) {
+	} else {
 #ifdef EVIOCSSUSPENDBLOCK
 		ioctl(fd, EVIOCSSUSPENDBLOCK, 0);
 #endif
-		d->select_worker.set_fd(&d->select_worker, -1);
-		d->select_worker.suspend(&d->select_worker);
 	}
-
 	return 0;
 }
 
-static int apds9700_set_delay(struct sensor_api_t *s, int64_t ns)
+static void apds9700_changed(struct evdev_desc *evdev, int value, int raw)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
 
-	d->delay = ns;
-	d->select_worker.set_delay(&d->select_worker, ns);
-
-	return 0;
-}
-
-static void apds9700_close(struct sensor_api_t *s)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-
-	d->select_worker.destroy(&d->select_worker);
-}
-
-static void apds9700_store_dist(struct sensor_desc *d, int value)
-{
-	d->distance = value ? 1.0 : 0.0;
 	apds9700_change_threshold(d);
 }
 
-static void *apds9700_read(void *arg)
-{
-	struct sensor_api_t *s = arg;
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	struct input_event event;
-	sensors_event_t data;
-	int ret;
-	int fd = d->select_worker.get_fd(&d->select_worker);
-
-	while ((ret = read(fd, &event, sizeof(event))) > 0) {
-		switch (event.type) {
-		case EV_MSC:
-			if (event.code == MSC_RAW)
-				apds9700_store_dist(d, event.value);
-			break;
-		case EV_ABS:
-			if (event.code == ABS_DISTANCE)
-				apds9700_store_dist(d, event.value);
-			break;
-		case EV_SYN:
-			memset(&data, 0, sizeof(data));
-
-			data.distance = d->distance;
-
-			data.version = apds970x.sensor.version;
-			data.sensor = apds970x.sensor.handle;
-			data.type = apds970x.sensor.type;
-			data.timestamp = get_current_nano_time();
-
-			sensors_fifo_put(&data);
-			break;
-		default:
-			break;
-		}
-	}
-
-exit:
-	return NULL;
-}
-
 list_constructor(apds9700_init_driver);
 void apds9700_init_driver()
 {
-	(void)sensors_list_register(&apds970x.sensor, &apds970x.api);
+	(void)sensors_list_register(&apds970x.evdev.sensor,
+				    &apds970x.evdev.api);
 }
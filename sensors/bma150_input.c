@@ -16,19 +16,13 @@
 
 #define LOG_TAG "DASH - bma150_input"
 
-#include <stdlib.h>
-#include <string.h>
-#include "sensors_log.h"
+#include <stdio.h>
+#include <limits.h>
 #include <sys/ioctl.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <linux/input.h>
-#include "sensors_list.h"
-#include "sensors_fifo.h"
-#include "sensors_select.h"
-#include "sensor_util.h"
+#include "sensors_log.h"
 #include "sensors_id.h"
 #include "sensors_config.h"
+#include "sensor_evdev.h"
 
 #define BMA150_INPUT_NAME "bma150"
 #define BMA150_CONVERT_AXES (1/12.742)
@@ -40,21 +34,13 @@ enum bma150_clients {
 	CLIENT_DELAY_UNUSED = 0,
 };
 
-static int bma150_input_init(struct sensor_api_t *s);
-static int bma150_input_activate(struct sensor_api_t *s, int enable);
+static int bma150_input_init(struct evdev_desc *evdev, int fd);
 static int bma150_input_fw_delay(struct sensor_api_t *s, int64_t ns);
-static void bma150_input_close(struct sensor_api_t *s);
-static void *bma150_input_read(void *arg);
+static void bma150_input_sync(struct evdev_desc *evdev, sensors_event_t *data);
 
 struct sensor_desc {
-	struct sensors_select_t select_worker;
-	struct sensor_t sensor;
-	struct sensor_api_t api;
-
-	int input_fd;
-	float current_data[3];
-
-	char *rate_path;
+	struct evdev_desc evdev;
+	struct sensors_config_notifier config_notifier;
 
 	/* config options */
 	int axis_x;
@@ -67,25 +53,36 @@ struct sensor_desc {
 	int64_t  delay_requests[MAX_CLIENTS];
 };
 
+static const struct evdev_field bma150_fields[] = {
+	{ EV_ABS, ABS_X, 0, 0, BMA150_CONVERT_AXES },
+	{ EV_ABS, ABS_Y, 1, 0, BMA150_CONVERT_AXES },
+	{ EV_ABS, ABS_Z, 2, 0, BMA150_CONVERT_AXES },
+};
+
 static struct sensor_desc bma150_input = {
-	.sensor = {
-		name: "BMA150 accelerometer",
-		vendor: "Bosch Sensortec GmbH",
-		version: sizeof(sensors_event_t),
-		handle: SENSOR_ACCELEROMETER_HANDLE,
-		type: SENSOR_TYPE_ACCELEROMETER,
-		maxRange: 9.81,
-		resolution: 20,
-		power: 0.13,
-		minDelay: 5000
+	.evdev = {
+		.sensor = {
+			name: "BMA150 accelerometer",
+			vendor: "Bosch Sensortec GmbH",
+			version: sizeof(sensors_event_t),
+			handle: SENSOR_ACCELEROMETER_HANDLE,
+			type: SENSOR_TYPE_ACCELEROMETER,
+			maxRange: 9.81,
+			resolution: 20,
+			power: 0.13,
+			minDelay: 5000
+		},
+		.api = {
+			init: sensor_evdev_init,
+			activate: sensor_evdev_activate,
+			set_delay: bma150_input_fw_delay,
+			close: sensor_evdev_close
+		},
+		.input_name = BMA150_INPUT_NAME,
+		EVDEV_FIELDS(bma150_fields),
+		.init = bma150_input_init,
+		.sync = bma150_input_sync,
 	},
-	.api = {
-		init: bma150_input_init,
-		activate: bma150_input_activate,
-		set_delay: bma150_input_fw_delay,
-		close: bma150_input_close
-	},
-	.input_fd = -1,
 	.axis_x = 0,
 	.axis_y = 1,
 	.axis_z = 2,
@@ -94,11 +91,6 @@ static struct sensor_desc bma150_input = {
 	.neg_z = 0
 };
 
-static inline float ev2grav(int evv)
-{
-	return ((float)evv * BMA150_CONVERT_AXES);
-}
-
 static void bma150_input_read_config(struct sensor_desc *d)
 {
 	int conf_axis_x, conf_axis_y, conf_axis_z;
@@ -153,94 +145,43 @@ static void bma150_input_read_config(struct sensor_desc *d)
 	d->neg_z = conf_neg_z;
 }
 
-static char *bma150_get_rate_path(int fd)
+static void bma150_input_reload_config(struct sensors_config_notifier *n)
 {
-	char *ret = NULL;
-	char sysfs_dev_path[100];
+	struct sensor_desc *d = container_of(n, struct sensor_desc,
+					     config_notifier);
 
-	if (ioctl(fd, EVIOCGPHYS(sizeof(sysfs_dev_path)), sysfs_dev_path) != -1) {
-		const char *rate = "/rate";
-		int len = strlen(sysfs_dev_path) + strlen(rate) + 1;
-		ret = malloc(len);
-		if (ret && snprintf(ret, len, "%s%s", sysfs_dev_path, rate) != len - 1) {
-			free(ret);
-			ret = NULL;
-		}
-	}
-	if (!ret)
-		ALOGE("%s: failed to get rate path", __func__);
-
-	return ret;
+	bma150_input_read_config(d);
 }
 
-static void bma150_set_rate(const struct sensor_desc *d, int rate_msec)
+static int bma150_input_init(struct evdev_desc *evdev, int fd)
 {
-	int rate_fd;
-	int rc = -1;
-
-	if (!d->rate_path)
-		return;
-
-	rate_fd = open(d->rate_path, O_WRONLY);
-	if (rate_fd >= 0) {
-		char new_rate[20];
-		rc = snprintf(new_rate, sizeof(new_rate), "%d\n", rate_msec);
-		if (rc > 0)
-			rc = write(rate_fd, new_rate, rc);
-		close(rate_fd);
-	}
-	if (rc <= 0)
-		ALOGE("%s: failed to set poll rate to %d ms", __func__, rate_msec);
-	return;
-}
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+	char sysfs_dev_path[100];
+	char rate_path[PATH_MAX];
+	int count;
 
-static int bma150_input_init(struct sensor_api_t *s)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd;
 	bma150_input_read_config(d);
+	d->config_notifier.reload = bma150_input_reload_config;
+	sensors_config_register_notifier(&d->config_notifier);
 
-	/* check for availablity */
-	fd = open_input_dev_by_name(BMA150_INPUT_NAME, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
-		ALOGE("%s: unable to find %s input device!\n", __func__,
-			BMA150_INPUT_NAME);
-		return -1;
+	/* the poll rate lives next to the device, not the input node */
+	if (ioctl(fd, EVIOCGPHYS(sizeof(sysfs_dev_path)), sysfs_dev_path) < 0) {
+		ALOGE("%s: failed to get rate path", __func__);
+		return 0;
 	}
-	d->rate_path = bma150_get_rate_path(fd);
-	close(fd);
-
-	sensors_select_init(&d->select_worker, bma150_input_read, s, -1);
-	return 0;
-}
-
-static int bma150_input_activate(struct sensor_api_t *s, int enable)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
-
-	/* suspend/resume will be handled in kernel-space */
-	if (enable && (fd < 0)) {
-		fd = open_input_dev_by_name(BMA150_INPUT_NAME,
-			O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			ALOGE("%s: failed to open input dev %s\n", __func__,
-				BMA150_INPUT_NAME);
-			return -1;
-		}
-		d->select_worker.set_fd(&d->select_worker, fd);
-		d->select_worker.resume(&d->select_worker);
-	} else if (!enable && (fd > 0)) {
-		d->select_worker.set_fd(&d->select_worker, -1);
-		d->select_worker.suspend(&d->select_worker);
+	count = snprintf(rate_path, sizeof(rate_path), "%s/rate",
+			 sysfs_dev_path);
+	if ((count < 0) || (count >= (int)sizeof(rate_path))) {
+		ALOGE("%s: failed to get rate path", __func__);
+		return 0;
 	}
+	sensor_evdev_open_rate(evdev, rate_path);
 
 	return 0;
 }
 
-static int bma150_input_set_delay(struct sensor_api_t *s)
+static int bma150_input_set_delay(struct sensor_desc *d)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
 	int i;
 	int64_t usec = d->delay_requests[0];
 	int64_t x;
@@ -251,20 +192,22 @@ static int bma150_input_set_delay(struct sensor_api_t *s)
 			usec = x;
 	}
 
-	if (usec < d->sensor.minDelay) {
-		usec = d->sensor.minDelay;
+	if (usec < d->evdev.sensor.minDelay) {
+		usec = d->evdev.sensor.minDelay;
 	}
 
-	bma150_set_rate(d, usec / 1000);
+	if (sensor_evdev_set_delay(&d->evdev.api, usec * 1000))
+		ALOGE("%s: failed to set poll rate to %d ms", __func__,
+		      (int)(usec / 1000));
 
 	return 0;
 }
 
 static int bma150_input_fw_delay(struct sensor_api_t *s, int64_t ns)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(s, struct sensor_desc, evdev.api);
 	d->delay_requests[CLIENT_ANDROID] = ns / 1000;
-	return bma150_input_set_delay(s);
+	return bma150_input_set_delay(d);
 }
 
 int bma150_input_request_delay(int *handle, int64_t ns)
@@ -297,7 +240,7 @@ int bma150_input_request_delay(int *handle, int64_t ns)
 
 found:
 	d->delay_requests[h] = ns;
-	err = bma150_input_set_delay(&bma150_input.api);
+	err = bma150_input_set_delay(d);
 	if (err) {
 		/* Delay not set - deallocate handle */
 		d->delay_requests[h] = CLIENT_DELAY_UNUSED;
@@ -306,76 +249,20 @@ found:
 	return err;
 }
 
-static void bma150_input_close(struct sensor_api_t *s)
+static void bma150_input_sync(struct evdev_desc *evdev, sensors_event_t *data)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+	float *v = evdev->value;
 
-	d->select_worker.destroy(&d->select_worker);
-	free(d->rate_path);
-}
-
-static void *bma150_input_read(void *arg)
-{
-	struct sensor_api_t *s = arg;
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	struct input_event event;
-	int fd = d->select_worker.get_fd(&d->select_worker);
-	sensors_event_t data;
-
-	memset(&data, 0, sizeof(data));
-	while (read(fd, &event, sizeof(event)) > 0) {
-		switch (event.type) {
-		case EV_ABS:
-			switch (event.code) {
-			case ABS_X:
-				d->current_data[0] = ev2grav(event.value);
-				break;
-
-			case ABS_Y:
-				d->current_data[1] = ev2grav(event.value);
-				break;
-
-			case ABS_Z:
-				d->current_data[2] = ev2grav(event.value);
-				break;
-
-			case ABS_MISC:
-			default:
-				break;
-			}
-			break;
-
-		case EV_SYN:
-
-			data.acceleration.x = (d->neg_x ? -d->current_data[d->axis_x] :
-							   d->current_data[d->axis_x]);
-			data.acceleration.y = (d->neg_y ? -d->current_data[d->axis_y] :
-							   d->current_data[d->axis_y]);
-			data.acceleration.z = (d->neg_z ? -d->current_data[d->axis_z] :
-							   d->current_data[d->axis_z]);
-			data.acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
-
-			data.sensor = bma150_input.sensor.handle;
-			data.type = bma150_input.sensor.type;
-			data.version = bma150_input.sensor.version;
-			data.timestamp = get_current_nano_time();
-
-			sensors_fifo_put(&data);
-
-			goto exit;
-
-		default:
-			goto exit;
-		}
-	}
-
-exit:
-	return NULL;
+	data->acceleration.x = (d->neg_x ? -v[d->axis_x] : v[d->axis_x]);
+	data->acceleration.y = (d->neg_y ? -v[d->axis_y] : v[d->axis_y]);
+	data->acceleration.z = (d->neg_z ? -v[d->axis_z] : v[d->axis_z]);
+	data->acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
 }
 
 list_constructor(bma150_input_init_driver);
 void bma150_input_init_driver()
 {
-	(void)sensors_list_register(&bma150_input.sensor, &bma150_input.api);
+	(void)sensors_list_register(&bma150_input.evdev.sensor,
+				    &bma150_input.evdev.api);
 }
-
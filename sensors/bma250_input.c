@@ -18,20 +18,15 @@
 
 #include <string.h>
 #include "sensors_log.h"
-#include <unistd.h>
-#include <fcntl.h>
-#include <linux/input.h>
-#include <errno.h>
-#include "sensors_list.h"
-#include "sensors_fifo.h"
-#include "sensors_select.h"
-#include "sensor_util.h"
 #include "sensors_id.h"
 #include "sensors_config.h"
-#include "sensors_sysfs.h"
+#include "sensor_evdev.h"
 
 #define BMA250_INPUT_NAME "bma250"
 
+/* bma250 driver sensitivity is 256 lsb/g for all g-ranges. */
+#define BMA250_CONVERT_AXES (9.81 / 256)
+
 #define VALID_HANDLE(h) ((h) > CLIENT_ANDROID && (h) < MAX_CLIENTS)
 
 enum bma250_clients {
@@ -40,21 +35,13 @@ enum bma250_clients {
 	CLIENT_DELAY_UNUSED = 0,
 };
 
-static int bma250_input_init(struct sensor_api_t *s);
-static int bma250_input_activate(struct sensor_api_t *s, int enable);
+static int bma250_input_init(struct evdev_desc *evdev, int fd);
 static int bma250_input_fw_delay(struct sensor_api_t *s, int64_t ns);
-static void bma250_input_close(struct sensor_api_t *s);
-static void *bma250_input_read(void *arg);
+static void bma250_input_sync(struct evdev_desc *evdev, sensors_event_t *data);
 
 struct sensor_desc {
-	struct sensors_select_t select_worker;
-	struct sensors_sysfs_t sysfs;
-	struct sensor_t sensor;
-	struct sensor_api_t api;
-
-	int input_fd;
-	float current_data[3];
-	int64_t delay;
+	struct evdev_desc evdev;
+	struct sensors_config_notifier config_notifier;
 
 	/* config options */
 	int axis_x;
@@ -68,25 +55,38 @@ struct sensor_desc {
 	int64_t  delay_requests[MAX_CLIENTS];
 };
 
+static const struct evdev_field bma250_fields[] = {
+	{ EV_ABS, ABS_X, 0, 0, BMA250_CONVERT_AXES },
+	{ EV_ABS, ABS_Y, 1, 0, BMA250_CONVERT_AXES },
+	{ EV_ABS, ABS_Z, 2, 0, BMA250_CONVERT_AXES },
+	/* temperature in ABS_MISC, 0.5C/lsb, is unused */
+};
+
 static struct sensor_desc bma250_input = {
-	.sensor = {
-		name: "BMA250 accelerometer",
-		vendor: "Bosch Sensortec GmbH",
-		version: sizeof(sensors_event_t),
-		handle: SENSOR_ACCELEROMETER_HANDLE,
-		type: SENSOR_TYPE_ACCELEROMETER,
-		maxRange: 156.96, /* max +/-16G */
-		resolution: 20,
-		power: 0.003,/* sleep 50ms */
-		minDelay: 5000
+	.evdev = {
+		.sensor = {
+			name: "BMA250 accelerometer",
+			vendor: "Bosch Sensortec GmbH",
+			version: sizeof(sensors_event_t),
+			handle: SENSOR_ACCELEROMETER_HANDLE,
+			type: SENSOR_TYPE_ACCELEROMETER,
+			maxRange: 156.96, /* max +/-16G */
+			resolution: 20,
+			power: 0.003,/* sleep 50ms */
+			minDelay: 5000
+		},
+		.api = {
+			init: sensor_evdev_init,
+			activate: sensor_evdev_activate,
+			set_delay: bma250_input_fw_delay,
+			close: sensor_evdev_close
+		},
+		.input_name = BMA250_INPUT_NAME,
+		.rate_attr = "bma250_rate",
+		EVDEV_FIELDS(bma250_fields),
+		.init = bma250_input_init,
+		.sync = bma250_input_sync,
 	},
-	.api = {
-		init: bma250_input_init,
-		activate: bma250_input_activate,
-		set_delay: bma250_input_fw_delay,
-		close: bma250_input_close
-	},
-	.input_fd = -1,
 	.axis_x = 0,
 	.axis_y = 1,
 	.axis_z = 2,
@@ -95,15 +95,6 @@ static struct sensor_desc bma250_input = {
 	.neg_z = 0
 };
 
-static inline float ev2grav(int evv)
-{
-	/* bma250 driver sensitivity is 256 lsb/g for all g-ranges. */
-	const float earth_g = 9.81;
-	const float lsb_per_g = 256;
-	float gravity_in_g = (float)evv / lsb_per_g;
-	return gravity_in_g * earth_g;
-}
-
 static void bma250_input_read_config(struct sensor_desc *d)
 {
 	int conf_axis_x, conf_axis_y, conf_axis_z;
@@ -158,149 +149,59 @@ static void bma250_input_read_config(struct sensor_desc *d)
 	d->neg_z = conf_neg_z;
 }
 
-static int bma250_input_init(struct sensor_api_t *s)
+static void bma250_input_reload_config(struct sensors_config_notifier *n)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd;
-	bma250_input_read_config(d);
-
-	fd = open_input_dev_by_name(BMA250_INPUT_NAME, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
-		ALOGE("%s: failed to open input dev %s, error: %s\n",
-			__func__, BMA250_INPUT_NAME, strerror(errno));
-		return -1;
-	}
-	close(fd);
+	struct sensor_desc *d = container_of(n, struct sensor_desc,
+					     config_notifier);
 
-	sensors_sysfs_init(&d->sysfs, BMA250_INPUT_NAME, SYSFS_TYPE_INPUT_DEV);
-	sensors_select_init(&d->select_worker, bma250_input_read, s, -1);
-
-	return 0;
+	bma250_input_read_config(d);
 }
 
-static int bma250_input_activate(struct sensor_api_t *s, int enable)
+static int bma250_input_init(struct evdev_desc *evdev, int fd)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
-
-	/* suspend/resume will be handled in kernel-space */
-	if (enable && (fd < 0)) {
-		fd = open_input_dev_by_name(BMA250_INPUT_NAME,
-			O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			ALOGE("%s: failed to open input dev %s, error: %s\n",
-				__func__, BMA250_INPUT_NAME, strerror(errno));
-			return -1;
-		}
-		d->select_worker.set_fd(&d->select_worker, fd);
-		d->select_worker.resume(&d->select_worker);
-	} else if (!enable && (fd > 0)) {
-		d->select_worker.set_fd(&d->select_worker, -1);
-		d->select_worker.suspend(&d->select_worker);
-	}
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+
+	bma250_input_read_config(d);
+	d->config_notifier.reload = bma250_input_reload_config;
+	sensors_config_register_notifier(&d->config_notifier);
+
 	return 0;
 }
 
 static int bma250_input_set_delay(struct sensor_api_t *s, int64_t ns)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
+	struct sensor_desc *d = container_of(s, struct sensor_desc, evdev.api);
 	unsigned int ms = ns/(1000*1000);
 	int ret;
 
-	d->delay = ns;
-	d->select_worker.set_delay(&d->select_worker, ns);
-
 	/* rate */
-	ret = d->sysfs.write_int(&d->sysfs, "bma250_rate", ms);
-	if (ret < 0) {
-		ALOGE("updating bma250_rate failed: %s\n", strerror(-ret));
+	ret = sensor_evdev_set_delay(s, ns);
+	if (ret < 0)
 		return ret;
-	}
 
 	/* range (optional) */
-	d->sysfs.write_int(&d->sysfs, "bma250_range", 2);
+	d->evdev.sysfs.write_int(&d->evdev.sysfs, "bma250_range", 2);
 
 	/* resolution (optional) */
-	d->sysfs.write_int(&d->sysfs, "bma250_resolution", (ms > 50) ? 0 : 1);
+	d->evdev.sysfs.write_int(&d->evdev.sysfs, "bma250_resolution",
+				 (ms > 50) ? 0 : 1);
 
 	return ret;
 }
 
-static void bma250_input_close(struct sensor_api_t *s)
+static void bma250_input_sync(struct evdev_desc *evdev, sensors_event_t *data)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+	float *v = evdev->value;
 
-	d->select_worker.destroy(&d->select_worker);
+	data->acceleration.x = (d->neg_x ? -v[d->axis_x] : v[d->axis_x]);
+	data->acceleration.y = (d->neg_y ? -v[d->axis_y] : v[d->axis_y]);
+	data->acceleration.z = (d->neg_z ? -v[d->axis_z] : v[d->axis_z]);
+	data->acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
 }
 
-static void *bma250_input_read(void *arg)
-{
-	struct sensor_api_t *s = arg;
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	struct input_event event;
-	int fd = d->select_worker.get_fd(&d->select_worker);
-	sensors_event_t data;
-
-	while (read(fd, &event, sizeof(event)) > 0) {
-		switch (event.type) {
-		case EV_ABS:
-			switch (event.code) {
-			case ABS_X:
-				d->current_data[0] = ev2grav(event.value);
-				break;
-
-			case ABS_Y:
-				d->current_data[1] = ev2grav(event.value);
-				break;
-
-			case ABS_Z:
-				d->current_data[2] = ev2grav(event.value);
-				break;
-
-			case ABS_MISC:
-				/* temperature, 0.5C/lsb */
-				break;
-
-			default:
-				ALOGE("%s: unknown event code 0x%X\n",
-					__func__, event.code);
-				goto exit;
-			}
-			break;
-
-		case EV_SYN:
-			data.acceleration.x = (d->neg_x ? -d->current_data[d->axis_x] :
-						d->current_data[d->axis_x]);
-			data.acceleration.y = (d->neg_y ? -d->current_data[d->axis_y] :
-						d->current_data[d->axis_y]);
-			data.acceleration.z = (d->neg_z ? -d->current_data[d->axis_z] :
-						d->current_data[d->axis_z]);
-			data.acceleration.status = SENSOR_STATUS_ACCURACY_HIGH;
-
-			data.sensor = bma250_input.sensor.handle;
-			data.type = bma250_input.sensor.type;
-			data.version = bma250_input.sensor.version;
-			data.timestamp = get_current_nano_time();
-
-			sensors_fifo_put(&data);
-			goto exit;
-
-		default:
-			ALOGE("%s: unknown event type 0x%X\n",
-				__func__, event.type);
-			goto exit;
-		}
-	}
-
-exit:
-	return NULL;
-}
-
-
-static int bma250_input_config_delay(struct sensor_api_t *s)
+static int bma250_input_config_delay(struct sensor_desc *d)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
 	int i;
 	int64_t usec = d->delay_requests[0];
 	int64_t x;
@@ -311,20 +212,20 @@ static int bma250_input_config_delay(struct sensor_api_t *s)
 			usec = x;
 	}
 
-	if (usec < d->sensor.minDelay) {
-		usec = d->sensor.minDelay;
+	if (usec < d->evdev.sensor.minDelay) {
+		usec = d->evdev.sensor.minDelay;
 	}
 
-	bma250_input_set_delay(s, usec);
+	bma250_input_set_delay(&d->evdev.api, usec);
 
 	return 0;
 }
 
 static int bma250_input_fw_delay(struct sensor_api_t *s, int64_t ns)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(s, struct sensor_desc, evdev.api);
 	d->delay_requests[CLIENT_ANDROID] = ns;
-	return bma250_input_config_delay(s);
+	return bma250_input_config_delay(d);
 }
 
 int bma250_input_request_delay(int *handle, int64_t ns)
@@ -353,7 +254,7 @@ int bma250_input_request_delay(int *handle, int64_t ns)
 
 found:
 	d->delay_requests[h] = ns;
-	err = bma250_input_config_delay(&bma250_input.api);
+	err = bma250_input_config_delay(d);
 	if (err) {
 		/* delay not set - deallocate handle */
 		d->delay_requests[h] = CLIENT_DELAY_UNUSED;
@@ -365,5 +266,6 @@ found:
 list_constructor(bma250_input_init_driver);
 void bma250_input_init_driver()
 {
-	(void)sensors_list_register(&bma250_input.sensor, &bma250_input.api);
+	(void)sensors_list_register(&bma250_input.evdev.sensor,
+				    &bma250_input.evdev.api);
 }
@@ -18,38 +18,24 @@
 
 #include <string.h>
 #include "sensors_log.h"
-#include <unistd.h>
-#include <fcntl.h>
-#include <linux/input.h>
-#include <errno.h>
-#include "sensors_list.h"
-#include "sensors_fifo.h"
-#include "sensors_select.h"
-#include "sensor_util.h"
 #include "sensors_id.h"
 #include "sensors_config.h"
 #include "sensors_wrapper.h"
-#include "sensors_sysfs.h"
+#include "sensor_evdev.h"
 
 #define BMA250_INPUT_NAME "bma250"
 
-static int bma250_input_init(struct sensor_api_t *s);
-static int bma250_input_activate(struct sensor_api_t *s, int enable);
+static int bma250_input_init(struct evdev_desc *evdev, int fd);
 static int bma250_input_set_delay(struct sensor_api_t *s, int64_t ns);
-static void bma250_input_close(struct sensor_api_t *s);
-static void *bma250_input_read(void *arg);
+static void bma250_input_sync(struct evdev_desc *evdev, sensors_event_t *data);
+static void bma250_input_flush(struct evdev_desc *evdev, sensors_event_t *data,
+			       int n);
 
 struct sensor_desc {
-	struct sensors_select_t select_worker;
-	struct sensors_sysfs_t sysfs;
-	struct sensor_t sensor;
-	struct sensor_api_t api;
+	struct evdev_desc evdev;
+	struct sensors_config_notifier config_notifier;
 	struct wrapper_entry entry;
 
-	int input_fd;
-	int current_data[3];
-	int64_t delay;
-
 	/* config options */
 	int axis_x;
 	int axis_y;
@@ -62,25 +48,39 @@ struct sensor_desc {
 	float scale;
 };
 
+static const struct evdev_field bma250_fields[] = {
+	{ EV_ABS, ABS_X, 0, 0, 1.0 },
+	{ EV_ABS, ABS_Y, 1, 0, 1.0 },
+	{ EV_ABS, ABS_Z, 2, 0, 1.0 },
+	/* temperature in ABS_MISC, 0.5C/lsb, is unused */
+};
+
 static struct sensor_desc bma250_input = {
-	.sensor = {
-		name: "BMA250 accelerometer",
-		vendor: "Bosch Sensortec GmbH",
-		version: sizeof(sensors_event_t),
-		handle: SENSOR_ACCELEROMETER_HANDLE,
-		type: SENSOR_TYPE_ACCELEROMETER,
-		maxRange: 156.96, /* max +/-16G */
-		resolution: 20,
-		power: 0.003,/* sleep 50ms */
-		minDelay: 5000
-	},
-	.api = {
-		init: bma250_input_init,
-		activate: bma250_input_activate,
-		set_delay: bma250_input_set_delay,
-		close: bma250_input_close
+	.evdev = {
+		.sensor = {
+			name: "BMA250 accelerometer",
+			vendor: "Bosch Sensortec GmbH",
+			version: sizeof(sensors_event_t),
+			handle: SENSOR_ACCELEROMETER_HANDLE,
+			type: SENSOR_TYPE_ACCELEROMETER,
+			maxRange: 156.96, /* max +/-16G */
+			resolution: 20,
+			power: 0.003,/* sleep 50ms */
+			minDelay: 5000
+		},
+		.api = {
+			init: sensor_evdev_init,
+			activate: sensor_evdev_activate,
+			set_delay: bma250_input_set_delay,
+			close: sensor_evdev_close
+		},
+		.input_name = BMA250_INPUT_NAME,
+		.rate_attr = "bma250_rate",
+		EVDEV_FIELDS(bma250_fields),
+		.init = bma250_input_init,
+		.sync = bma250_input_sync,
+		.flush = bma250_input_flush,
 	},
-	.input_fd = -1,
 	.axis_x = 0,
 	.axis_y = 1,
 	.axis_z = 2,
@@ -144,148 +144,73 @@ static void bma250_input_read_config(struct sensor_desc *d)
 	d->neg_z = conf_neg_z;
 }
 
-static int bma250_input_init(struct sensor_api_t *s)
+static void bma250_input_reload_config(struct sensors_config_notifier *n)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd;
-	bma250_input_read_config(d);
-
-	fd = open_input_dev_by_name(BMA250_INPUT_NAME, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
-		ALOGE("%s: failed to open input dev %s, error: %s\n",
-			__func__, BMA250_INPUT_NAME, strerror(errno));
-		return -1;
-	}
-	close(fd);
+	struct sensor_desc *d = container_of(n, struct sensor_desc,
+					     config_notifier);
 
-	sensors_sysfs_init(&d->sysfs, BMA250_INPUT_NAME, SYSFS_TYPE_INPUT_DEV);
-	sensors_select_init(&d->select_worker, bma250_input_read, s, -1);
-
-	return 0;
+	bma250_input_read_config(d);
 }
 
-static int bma250_input_activate(struct sensor_api_t *s, int enable)
+static int bma250_input_init(struct evdev_desc *evdev, int fd)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+
+	bma250_input_read_config(d);
+	d->config_notifier.reload = bma250_input_reload_config;
+	sensors_config_register_notifier(&d->config_notifier);
 
-	/* suspend/resume will be handled in kernel-space */
-	if (enable && (fd < 0)) {
-		fd = open_input_dev_by_name(BMA250_INPUT_NAME,
-			O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			ALOGE("%s: failed to open input dev %s, error: %s\n",
-				__func__, BMA250_INPUT_NAME, strerror(errno));
-			return -1;
-		}
-		d->select_worker.set_fd(&d->select_worker, fd);
-		d->select_worker.resume(&d->select_worker);
-	} else if (!enable && (fd > 0)) {
-		d->select_worker.set_fd(&d->select_worker, -1);
-		d->select_worker.suspend(&d->select_worker);
-	}
 	return 0;
 }
 
 static int bma250_input_set_delay(struct sensor_api_t *s, int64_t ns)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
+	struct sensor_desc *d = container_of(s, struct sensor_desc, evdev.api);
 	int64_t usec = ns / 1000;
-	int ret;
-
-	if (usec < d->sensor.minDelay)
-		usec = d->sensor.minDelay;
 
-	d->delay = usec * 1000;
-	d->select_worker.set_delay(&d->select_worker, d->delay);
-	ret = d->sysfs.write_int(&d->sysfs, "bma250_rate", usec / 1000);
-	if (ret < 0)
-		ALOGE("updating bma250_rate failed: %s\n", strerror(-ret));
+	if (usec < d->evdev.sensor.minDelay)
+		usec = d->evdev.sensor.minDelay;
 
-	return ret;
+	return sensor_evdev_set_delay(s, usec * 1000);
 }
 
-static void bma250_input_close(struct sensor_api_t *s)
+/* axis config is applied per sample, see reload */
+static void bma250_input_sync(struct evdev_desc *evdev, sensors_event_t *data)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+	float *v = evdev->value;
 
-	d->select_worker.destroy(&d->select_worker);
+	data->data[d->axis_x] = d->neg_x ? -v[0] : v[0];
+	data->data[d->axis_y] = d->neg_y ? -v[1] : v[1];
+	data->data[d->axis_z] = d->neg_z ? -v[2] : v[2];
 }
 
-#define MAX_EVENTS 5 /* X, Y, Z, MISC, SYN */
-static void *bma250_input_read(void *arg)
+/* hand the raw samples to the wrapper sensors in one go */
+static void bma250_input_flush(struct evdev_desc *evdev, sensors_event_t *data,
+			       int n)
 {
-	struct sensor_api_t *s = arg;
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	struct input_event events[MAX_EVENTS];
-	struct input_event *e;
-	int fd;
-	int n;
-	int i;
-	struct sensor_data_t sd;
+	struct sensor_desc *d = container_of(evdev, struct sensor_desc, evdev);
+	struct sensor_data_t sd[EVDEV_BATCH];
+	int raw[EVDEV_BATCH][3];
+	int i, j;
 
-	fd = d->select_worker.get_fd(&d->select_worker);
-
-	n = read(fd, events, sizeof(events));
-	if (n < 0) {
-		ALOGE("%s: read error from fd %d, errno %d", __func__, fd, errno);
-		goto exit;
-	}
-	n = n / sizeof(events[0]);
 	for (i = 0; i < n; i++) {
-		e = events + i;
-		switch (e->type) {
-		case EV_ABS:
-			switch (e->code) {
-			case ABS_X:
-				d->current_data[d->axis_x] = d->neg_x ? -e->value : e->value;
-				break;
-
-			case ABS_Y:
-				d->current_data[d->axis_y] = d->neg_y ? -e->value : e->value;
-				break;
-
-			case ABS_Z:
-				d->current_data[d->axis_z] = d->neg_z ? -e->value : e->value;
-				break;
-
-			case ABS_MISC:
-				/* temperature, 0.5C/lsb */
-				break;
-
-			default:
-				ALOGE("%s: unknown event code 0x%X\n",
-					__func__, e->code);
-				break;
-			}
-			break;
-
-		case EV_SYN:
-			memset(&sd, 0, sizeof(sd));
-			sd.sensor = &d->sensor;
-			sd.timestamp = get_current_nano_time();
-			sd.data = d->current_data;
-			sd.scale = d->scale;
-			sd.status = SENSOR_STATUS_ACCURACY_HIGH;
-
-			sensors_wrapper_data(&sd);
-			break;
-
-		default:
-			ALOGE("%s: unknown event type 0x%X\n",
-				__func__, e->type);
-			break;
-		}
+		for (j = 0; j < 3; j++)
+			raw[i][j] = data[i].data[j];
+		memset(&sd[i], 0, sizeof(sd[i]));
+		sd[i].sensor = &evdev->sensor;
+		sd[i].timestamp = data[i].timestamp;
+		sd[i].data = raw[i];
+		sd[i].scale = d->scale;
+		sd[i].status = SENSOR_STATUS_ACCURACY_HIGH;
 	}
-
-exit:
-	return NULL;
+	sensors_wrapper_data_batch(sd, n);
 }
 
 list_constructor(bma250na_input_init_driver);
 void bma250na_input_init_driver()
 {
-	(void)sensors_wrapper_register(&bma250_input.sensor, &bma250_input.api,
+	(void)sensors_wrapper_register(&bma250_input.evdev.sensor,
+				       &bma250_input.evdev.api,
 				       &bma250_input.entry);
 }
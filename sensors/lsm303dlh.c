@@ -32,6 +32,7 @@
 #include "sensor_util.h"
 #include "sensors_id.h"
 #include "sensors_config.h"
+#include "sensors_root.h"
 #include "lsm303dlh.h"
 #include "sensors_compass_API.h"
 
@@ -39,9 +40,11 @@
 #define DELAY_LOWEST_MS 1000
 #define DEBUG_VERBOSE 0
 #define PHYS_PATH_BASE "/sys/bus/i2c/devices"
-#define PHYS_PATH_LEN  (sizeof(PHYS_PATH_BASE) + sizeof("/0-0000/"))
+#define PHYS_PATH_LEN  (SENSORS_ROOT_MAX + sizeof(PHYS_PATH_BASE) + \
+			sizeof("/0-0000/"))
 #define ATTR_NAME_LEN  32
-#define DEV_PATH_LEN  sizeof("/dev/input/event/4294967295")
+#define DEV_PATH_LEN  (SENSORS_ROOT_MAX + \
+			sizeof("/dev/input/event/4294967295"))
 
 
 enum android_rates {
@@ -81,7 +84,9 @@ struct sensor_desc {
 	struct sensor_t sensor;
 	struct sensor_api_t api;
 	struct sensors_select_t select_worker;
+	struct sensors_config_notifier config_notifier;
 	int status;
+	int raw[3];
 	int data[3];
 	char *map_prefix;
 	int map[3];
@@ -164,6 +169,16 @@ static void config_read_sensor_map(struct sensor_desc *d)
 	     d->sign[AXIS_X], d->sign[AXIS_Y], d->sign[AXIS_Z]);
 }
 
+static void config_reload_sensor_map(struct sensors_config_notifier *n)
+{
+	struct sensor_desc *d = container_of(n, struct sensor_desc,
+					     config_notifier);
+
+	pthread_mutex_lock(&lock);
+	config_read_sensor_map(d);
+	pthread_mutex_unlock(&lock);
+}
+
 static int store_str_attr(struct sensor_desc *d, const char *attr,
 			const char *val)
 {
@@ -323,6 +338,8 @@ static int sensor_init(struct sensor_api_t *s_api)
 	}
 
 	config_read_sensor_map(d);
+	d->config_notifier.reload = config_reload_sensor_map;
+	sensors_config_register_notifier(&d->config_notifier);
 	sensors_select_init(&d->select_worker, d->read, d, -1);
 
 	return 0;
@@ -607,6 +624,10 @@ static void *sensor_read(void *arg)
 		if (e->type == EV_SYN &&
 				p->sensor.type != SENSOR_TYPE_ORIENTATION) {
 
+			p->data[p->map[0]] = p->raw[0] * p->sign[0];
+			p->data[p->map[1]] = p->raw[1] * p->sign[1];
+			p->data[p->map[2]] = p->raw[2] * p->sign[2];
+
 			ALOGD_IF(DEBUG_VERBOSE, "%s(%s):%9lld %6d %6d %6d",
 					__func__,
 					p->sensor.name,
@@ -661,13 +682,13 @@ static void *sensor_read(void *arg)
 
 		switch (e->code) {
 		case ABS_X:
-			p->data[p->map[0]] = e->value * p->sign[0];
+			p->raw[0] = e->value;
 			break;
 		case ABS_Y:
-			p->data[p->map[1]] = e->value * p->sign[1];
+			p->raw[1] = e->value;
 			break;
 		case ABS_Z:
-			p->data[p->map[2]] = e->value * p->sign[2];
+			p->raw[2] = e->value;
 			break;
 		}
 	}
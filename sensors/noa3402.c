@@ -16,34 +16,23 @@
 
 #define LOG_TAG "DASH - proximity_noa3402"
 
-#include <stdlib.h>
 #include <string.h>
-#include "sensors_log.h"
+#include <unistd.h>
 #include <fcntl.h>
-#include <linux/input.h>
 #include <errno.h>
-#include "sensors_list.h"
-#include "sensors_fifo.h"
-#include "sensors_select.h"
-#include "sensor_util.h"
+#include "sensors_log.h"
 #include "sensors_id.h"
+#include "sensor_evdev.h"
 
 #define NOA3402_NAME "noa3402"
 
-static int noa3402_init(struct sensor_api_t *s);
-static int noa3402_activate(struct sensor_api_t *s, int enable);
-static int noa3402_set_delay(struct sensor_api_t *s, int64_t ns);
-static void noa3402_close(struct sensor_api_t *s);
-static void *noa3402_read(void *arg);
+static int noa3402_enable(struct evdev_desc *d, int fd, int enable);
 
-struct sensor_desc {
-	struct sensors_select_t select_worker;
-	struct sensor_t sensor;
-	struct sensor_api_t api;
-	float distance;
+static const struct evdev_field noa3402_fields[] = {
+	{ EV_ABS, ABS_DISTANCE, 0, EVDEV_FIELD_BOOL },
 };
 
-static struct sensor_desc noa3402 = {
+static struct evdev_desc noa3402 = {
 	.sensor = {
 		.name = "NOA3402 Proximity",
 		.vendor = "Sony",
@@ -55,26 +44,17 @@ static struct sensor_desc noa3402 = {
 		.power = 20
 	},
 	.api = {
-		.init = noa3402_init,
-		.activate = noa3402_activate,
-		.set_delay = noa3402_set_delay,
-		.close = noa3402_close
-	}
+		.init = sensor_evdev_init,
+		.activate = sensor_evdev_activate,
+		.set_delay = sensor_evdev_set_delay,
+		.close = sensor_evdev_close
+	},
+	.input_name = NOA3402_NAME,
+	EVDEV_FIELDS(noa3402_fields),
+	.size = 1,
+	.enable = noa3402_enable,
 };
 
-static void noa3402_report_distance(float distance)
-{
-	sensors_event_t data;
-
-	memset(&data, 0, sizeof(data));
-	data.distance = distance;
-	data.version = noa3402.sensor.version;
-	data.sensor = noa3402.sensor.handle;
-	data.type = noa3402.sensor.type;
-	data.timestamp = get_current_nano_time();
-	sensors_fifo_put(&data);
-}
-
 static int noa3402_get_current_distance(float *current_distance)
 {
 	int ret = 0;
@@ -98,98 +78,18 @@ exit:
 	return ret;
 }
 
-static int noa3402_init(struct sensor_api_t *s)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd;
-
-	/* check for availablity */
-	fd = open_input_dev_by_name(NOA3402_NAME, O_RDONLY | O_NONBLOCK);
-	if (fd < 0) {
-		ALOGE("%s: unable to find %s input device!\n", __func__,
-			NOA3402_NAME);
-		return fd;
-	}
-	close(fd);
-
-	sensors_select_init(&d->select_worker, noa3402_read, s, -1);
-	return 0;
-}
-
-static int noa3402_activate(struct sensor_api_t *s, int enable)
+static int noa3402_enable(struct evdev_desc *d, int fd, int enable)
 {
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int fd = d->select_worker.get_fd(&d->select_worker);
 	float current_distance;
 
-	if (enable && (fd < 0)) {
-		fd = open_input_dev_by_name(NOA3402_NAME,
-			O_RDONLY | O_NONBLOCK);
-		if (fd < 0) {
-			ALOGE("%s: failed to open input dev %s\n", __func__,
-				NOA3402_NAME);
-			return fd;
-		}
-		d->select_worker.set_fd(&d->select_worker, fd);
-		d->select_worker.resume(&d->select_worker);
-		if (!noa3402_get_current_distance(&current_distance))
-			noa3402_report_distance(current_distance);
-	} else if (!enable && (fd > 0)) {
-		d->select_worker.set_fd(&d->select_worker, -1);
-		d->select_worker.suspend(&d->select_worker);
+	/* report the state the chip is in, no event comes until it changes */
+	if (enable && !noa3402_get_current_distance(&current_distance)) {
+		d->value[0] = current_distance;
+		sensor_evdev_report(d);
 	}
-
 	return 0;
 }
 
-static int noa3402_set_delay(struct sensor_api_t *s, int64_t ns)
-{
-	/* N/A for this chip, but required by sensor HAL */
-	return 0;
-}
-
-static void noa3402_close(struct sensor_api_t *s)
-{
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-
-	d->select_worker.destroy(&d->select_worker);
-}
-
-static void *noa3402_read(void *arg)
-{
-	struct sensor_api_t *s = arg;
-	struct sensor_desc *d = container_of(s, struct sensor_desc, api);
-	int bytes, i;
-	struct input_event event[2];
-	int fd = d->select_worker.get_fd(&d->select_worker);
-
-	bytes = read(fd, event, sizeof(event));
-	if (bytes < 0) {
-		ALOGE("%s: read failed, error: %d\n", __func__, bytes);
-		return NULL;
-	}
-
-	for (i = 0; i < (bytes / (int)sizeof(struct input_event)); i++) {
-		switch (event[i].type) {
-		case EV_ABS:
-			if (event[i].code == ABS_DISTANCE)
-				d->distance = event[i].value ? 1.0 : 0.0;
-			else
-				ALOGE("%s: unknown event code 0x%X\n",
-						__func__, event[i].code);
-			break;
-		case EV_SYN:
-			noa3402_report_distance(d->distance);
-			break;
-		default:
-			ALOGE("%s: unknown event type 0x%X\n",
-						__func__, event[i].type);
-			break;
-		}
-	}
-	return NULL;
-}
-
 list_constructor(noa3402_init_driver);
 void noa3402_init_driver()
 {
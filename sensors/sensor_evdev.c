@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DASH - evdev"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include "sensors_log.h"
+#include "sensors_fifo.h"
+#include "sensors_stats.h"
+#include "sensors_trace.h"
+#include "sensor_evdev.h"
+
+#define MAX_EVENTS (EVDEV_BATCH * (EVDEV_MAX_VALUES + 1))
+
+static int open_input(struct evdev_desc *d)
+{
+	int fd;
+
+	fd = open_input_dev_by_name(d->input_name, O_RDONLY | O_NONBLOCK);
+	if (fd < 0)
+		ALOGE("%s: failed to open input dev %s, error: %s\n",
+			__func__, d->input_name, strerror(errno));
+	return fd;
+}
+
+int sensor_evdev_open_rate(struct evdev_desc *d, const char *path)
+{
+	if (d->rate_fd >= 0)
+		close(d->rate_fd);
+
+	d->rate_fd = open(path, O_WRONLY);
+	if (d->rate_fd < 0) {
+		ALOGE("%s: unable to open %s: %s\n", __func__, path,
+			strerror(errno));
+		return -errno;
+	}
+	return 0;
+}
+
+static void open_rate_attr(struct evdev_desc *d)
+{
+	char path[PATH_MAX];
+	int count;
+
+	if (sensors_sysfs_init(&d->sysfs, d->input_name, SYSFS_TYPE_INPUT_DEV))
+		return;
+
+	count = snprintf(path, sizeof(path), "%s/%s", d->sysfs.data.path,
+			 d->rate_attr);
+	if ((count < 0) || (count >= (int)sizeof(path))) {
+		ALOGE("%s: snprintf failed!\n", __func__);
+		return;
+	}
+	sensor_evdev_open_rate(d, path);
+}
+
+int sensor_evdev_init(struct sensor_api_t *s)
+{
+	struct evdev_desc *d = container_of(s, struct evdev_desc, api);
+	int fd = -1;
+	int rc = 0;
+
+	d->rate_fd = -1;
+
+	if (!(d->flags & EVDEV_NO_PROBE)) {
+		/* check for availability */
+		fd = open_input(d);
+		if (fd < 0)
+			return -1;
+	}
+
+	if (d->rate_attr)
+		open_rate_attr(d);
+
+	if (d->init)
+		rc = d->init(d, fd);
+	if (fd >= 0)
+		close(fd);
+	if (rc < 0)
+		return rc;
+
+	sensors_select_init(&d->select_worker, sensor_evdev_read, d, -1);
+
+	return 0;
+}
+
+int sensor_evdev_activate(struct sensor_api_t *s, int enable)
+{
+	struct evdev_desc *d = container_of(s, struct evdev_desc, api);
+	int fd = d->select_worker.get_fd(&d->select_worker);
+	int rc;
+
+	/* suspend/resume will be handled in kernel-space */
+	if (enable && (fd < 0)) {
+		fd = open_input(d);
+		if (fd < 0)
+			return -1;
+		if (d->enable) {
+			rc = d->enable(d, fd, 1);
+			if (rc) {
+				close(fd);
+				return rc;
+			}
+		}
+		d->kernel_clock = input_set_kernel_clock(fd);
+		d->select_worker.set_fd(&d->select_worker, fd);
+		d->select_worker.resume(&d->select_worker);
+	} else if (!enable && (fd >= 0)) {
+		if (d->enable)
+			d->enable(d, fd, 0);
+		d->select_worker.set_fd(&d->select_worker, -1);
+		d->select_worker.suspend(&d->select_worker);
+	}
+
+	return 0;
+}
+
+int sensor_evdev_set_delay(struct sensor_api_t *s, int64_t ns)
+{
+	struct evdev_desc *d = container_of(s, struct evdev_desc, api);
+	char buf[16];
+	int count;
+	int rc;
+
+	d->delay = ns;
+	d->select_worker.set_delay(&d->select_worker, ns);
+
+	if (d->rate_fd < 0)
+		return 0;
+
+	count = snprintf(buf, sizeof(buf), "%d", (int)(ns / 1000000));
+	if ((count < 0) || (count >= (int)sizeof(buf)))
+		return -1;
+
+	rc = pwrite(d->rate_fd, buf, count, 0);
+	if (rc < 0) {
+		rc = -errno;
+		ALOGE("%s: updating %s rate failed: %s\n", __func__,
+			d->sensor.name, strerror(errno));
+		return rc;
+	}
+
+	return 0;
+}
+
+void sensor_evdev_close(struct sensor_api_t *s)
+{
+	struct evdev_desc *d = container_of(s, struct evdev_desc, api);
+
+	d->select_worker.destroy(&d->select_worker);
+	if (d->rate_fd >= 0) {
+		close(d->rate_fd);
+		d->rate_fd = -1;
+	}
+}
+
+static const struct evdev_field *find_field(struct evdev_desc *d,
+					    const struct input_event *e)
+{
+	int i;
+
+	for (i = 0; i < d->nr_fields; i++) {
+		if (d->fields[i].type == e->type &&
+		    d->fields[i].code == e->code)
+			return &d->fields[i];
+	}
+	return NULL;
+}
+
+static void build_frame(struct evdev_desc *d, sensors_event_t *data,
+			int64_t timestamp)
+{
+	int i;
+
+	memset(data, 0, sizeof(*data));
+	data->version = d->sensor.version;
+	data->sensor = d->sensor.handle;
+	data->type = d->sensor.type;
+	data->timestamp = timestamp;
+	for (i = 0; i < d->size; i++)
+		data->data[i] = d->value[i];
+
+	if (d->sync)
+		d->sync(d, data);
+}
+
+static void flush_frames(struct evdev_desc *d, sensors_event_t *data, int n)
+{
+	int64_t now;
+	int i;
+
+	if (!n)
+		return;
+
+	/* without a kernel clock, keep only the spacing of event times */
+	now = get_current_nano_time();
+	if (d->kernel_clock) {
+		for (i = 0; i < n; i++)
+			sensors_stats_latency(data[i].sensor, STATS_READ,
+					      now - data[i].timestamp);
+	} else {
+		now -= data[n - 1].timestamp;
+		for (i = 0; i < n; i++)
+			data[i].timestamp += now;
+	}
+
+	if (d->flush)
+		d->flush(d, data, n);
+	else
+		sensors_fifo_put_batch(data, n);
+}
+
+/* report the current values now, e.g. an initial state on enable */
+void sensor_evdev_report(struct evdev_desc *d)
+{
+	sensors_event_t data;
+
+	build_frame(d, &data, get_current_nano_time());
+	if (d->flush)
+		d->flush(d, &data, 1);
+	else
+		sensors_fifo_put(&data);
+}
+
+void *sensor_evdev_read(void *arg)
+{
+	struct evdev_desc *d = arg;
+	struct input_event events[MAX_EVENTS];
+	sensors_event_t data[EVDEV_BATCH];
+	const struct evdev_field *f;
+	const struct input_event *e;
+	int fd = d->select_worker.get_fd(&d->select_worker);
+	int frames = 0;
+	int reported = 0;
+	int i, n;
+
+	TRACE_BEGIN("evdev_read");
+	n = read(fd, events, sizeof(events));
+	TRACE_END();
+	if (n < 0) {
+		if (errno != EAGAIN)
+			ALOGE("%s: read error '%s' from fd %d sensor '%s'",
+				__func__, strerror(errno), fd, d->sensor.name);
+		return NULL;
+	}
+
+	TRACE_BEGIN("evdev_parse");
+
+	n = n / sizeof(events[0]);
+	for (i = 0; i < n; i++) {
+		e = events + i;
+		if (e->type == EV_SYN) {
+			if ((e->code != SYN_REPORT) ||
+			    (d->flags & EVDEV_NO_SYN_REPORT))
+				continue;
+		} else {
+			f = find_field(d, e);
+			if (!f)
+				continue;
+			if (f->flags & EVDEV_FIELD_BOOL)
+				d->value[f->value] = e->value ? 1.0 : 0.0;
+			else
+				d->value[f->value] = e->value * f->scale;
+			if (d->changed)
+				d->changed(d, f->value, e->value);
+			if (!(f->flags & EVDEV_FIELD_REPORT))
+				continue;
+		}
+
+		build_frame(d, &data[frames], input_event_time(e));
+		reported = 1;
+		if (++frames == EVDEV_BATCH) {
+			flush_frames(d, data, frames);
+			frames = 0;
+		}
+	}
+	flush_frames(d, data, frames);
+	TRACE_END();
+
+	if ((d->flags & EVDEV_SLEEP_ON_SYNC) && reported)
+		sensors_nsleep(d->delay);
+
+	return NULL;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSOR_EVDEV_H
+#define SENSOR_EVDEV_H
+
+#include <linux/input.h>
+#include "sensors_list.h"
+#include "sensors_select.h"
+#include "sensors_sysfs.h"
+#include "sensor_util.h"
+
+/* frames decoded by one read */
+#define EVDEV_BATCH 16
+#define EVDEV_MAX_VALUES 4
+
+enum evdev_field_flags {
+	EVDEV_FIELD_BOOL   = 1 << 0, /* store value ? 1 : 0 */
+	EVDEV_FIELD_REPORT = 1 << 1, /* report a frame without EV_SYN */
+};
+
+enum evdev_flags {
+	EVDEV_NO_PROBE      = 1 << 0, /* do not look for the device at init */
+	EVDEV_SLEEP_ON_SYNC = 1 << 1, /* throttle reads to the set delay */
+	EVDEV_NO_SYN_REPORT = 1 << 2, /* frames come from REPORT fields only */
+};
+
+/* one input event code and where its value goes */
+struct evdev_field {
+	unsigned short type;
+	unsigned short code;
+	unsigned char value;
+	unsigned char flags;
+	float scale;
+};
+
+struct evdev_desc {
+	struct sensor_t sensor;
+	struct sensor_api_t api;
+	struct sensors_select_t select_worker;
+	struct sensors_sysfs_t sysfs;
+
+	char *input_name;
+	unsigned flags;
+	const struct evdev_field *fields;
+	int nr_fields;
+	int size;			/* values reported per frame */
+	char *rate_attr;		/* input device attribute, ms */
+
+	/* optional driver hooks */
+	int (*init)(struct evdev_desc *d, int fd);
+	int (*enable)(struct evdev_desc *d, int fd, int enable);
+	void (*changed)(struct evdev_desc *d, int value, int raw);
+	void (*sync)(struct evdev_desc *d, sensors_event_t *data);
+	void (*flush)(struct evdev_desc *d, sensors_event_t *data, int n);
+
+	float value[EVDEV_MAX_VALUES];
+	int64_t delay;
+	int rate_fd;
+	int kernel_clock;
+};
+
+#define EVDEV_FIELDS(f) .fields = f, .nr_fields = sizeof(f) / sizeof(f[0])
+
+int sensor_evdev_init(struct sensor_api_t *s);
+int sensor_evdev_activate(struct sensor_api_t *s, int enable);
+int sensor_evdev_set_delay(struct sensor_api_t *s, int64_t ns);
+void sensor_evdev_close(struct sensor_api_t *s);
+void *sensor_evdev_read(void *arg);
+int sensor_evdev_open_rate(struct evdev_desc *d, const char *path);
+void sensor_evdev_report(struct evdev_desc *d);
+
+#endif
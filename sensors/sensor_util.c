@@ -31,6 +31,7 @@
 #include <ctype.h>
 #include "sensors_log.h"
 #include "sensors_input_cache.h"
+#include "sensors_root.h"
 
 #define NSEC_PER_SEC 1000000000L
 static int64_t timespec_to_ns(const struct timespec *ts)
@@ -90,19 +91,22 @@ int open_input_dev_by_name(char *name, int flags)
 int input_dev_path_by_keycode(int type, int code, char *path, int path_max)
 {
 	uint8_t bits[bit_array_size(KEY_MAX + 1)];
+	char dir_path[PATH_MAX];
 	int rc;
 	int fd;
 	DIR * dir;
 	struct dirent * item;
 
-	dir = opendir(INPUT_EVENT_DIR);
+	snprintf(dir_path, sizeof(dir_path), "%s%s", sensors_root(),
+		 INPUT_EVENT_DIR);
+	dir = opendir(dir_path);
 	while (NULL != dir && NULL != (item = readdir(dir))) {
 		if (0 != strncmp(item->d_name, INPUT_EVENT_BASENAME,
 				sizeof(INPUT_EVENT_BASENAME) - 1)) {
 			continue;
 		}
 
-		snprintf(path, path_max, "%s%s", INPUT_EVENT_DIR, item->d_name);
+		snprintf(path, path_max, "%s%s", dir_path, item->d_name);
 		fd = open(path, O_RDONLY);
 		if (fd < 0) {
 			continue;
@@ -127,6 +131,7 @@ int dev_phys_path_by_attr(const char *attr, const char *attr_val,
 			const char *base, char *path, int path_max)
 {
 	char aval[32];
+	char base_path[PATH_MAX];
 	int rc;
 	int notfound = 1;
 	int fd;
@@ -134,9 +139,10 @@ int dev_phys_path_by_attr(const char *attr, const char *attr_val,
 	struct dirent * item;
 	int len = strlen(attr_val);
 
-	dir = opendir(base);
+	snprintf(base_path, sizeof(base_path), "%s%s", sensors_root(), base);
+	dir = opendir(base_path);
 	if (!dir) {
-		ALOGE("Unable to open '%s'", base);
+		ALOGE("Unable to open '%s'", base_path);
 		return -1;
 	}
 
@@ -146,7 +152,7 @@ int dev_phys_path_by_attr(const char *attr, const char *attr_val,
 		if (item->d_name[0] == '.')
 			continue;
 		rc = snprintf(path, path_max, "%s/%s/%s",
-				base, item->d_name, attr);
+				base_path, item->d_name, attr);
 		if (rc >= path_max) {
 			ALOGD("Entry name truncated '%s'", path);
 			continue;
@@ -175,3 +181,15 @@ int dev_phys_path_by_attr(const char *attr, const char *attr_val,
 
 	return notfound;
 }
+
+/* deliver event times on the same clock as get_current_nano_time() */
+int input_set_kernel_clock(int fd)
+{
+#ifdef EVIOCSCLOCKID
+	int clk = CLOCK_MONOTONIC;
+
+	return !ioctl(fd, EVIOCSCLOCKID, &clk);
+#else
+	return 0;
+#endif
+}
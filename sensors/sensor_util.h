@@ -17,6 +17,7 @@
 #ifndef SENSOR_UTIL_H_
 #define SENSOR_UTIL_H_
 #include <stdint.h>
+#include <linux/input.h>
 
 #define container_of(ptr, type, member) ({ \
 	const typeof( ((type *)0)->member ) *__mptr = (ptr); \
@@ -37,5 +38,12 @@ int input_dev_path_by_name(char *name, char *path, int path_max);
 int input_dev_path_by_keycode(int type, int code, char *path, int path_max);
 int dev_phys_path_by_attr(const char *attr, const char *attr_val,
 			const char *base, char *path, int path_max);
+int input_set_kernel_clock(int fd);
+
+static inline int64_t input_event_time(const struct input_event *e)
+{
+	return (int64_t)e->time.tv_sec * 1000000000LL +
+		(int64_t)e->time.tv_usec * 1000;
+}
 
 #endif
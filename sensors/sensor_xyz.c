@@ -16,10 +16,13 @@
 
 #define LOG_TAG "DASH - xyz"
 
+#include <unistd.h>
 #include "sensor_xyz.h"
+#include "sensors_stats.h"
+#include "sensors_trace.h"
 
 #define NS_TO_MS 1000000
-#define MAX_EVENTS 4 /* X, Y, Z, SYN */
+#define MAX_EVENTS (XYZ_BATCH * 4) /* X, Y, Z, SYN */
 
 struct config_record {
 	int max;
@@ -76,6 +79,41 @@ static void config_read_sensor_map(struct sensor_desc *d)
 	config_read_axis(d->map_prefix, "axis_sign", &rec);
 }
 
+static inline v4si splat(int c)
+{
+	v4si v = {c, c, c, c};
+	return v;
+}
+
+/*
+ * Fold axis map and sign into a matrix, out = remap * raw. A map entry
+ * used twice keeps the last axis as the per-axis code did.
+ */
+static void build_remap(struct sensor_desc *d)
+{
+	int i, j;
+
+	for (i = 0; i < NUM_AXIS; i++)
+		for (j = 0; j < NUM_AXIS; j++)
+			d->remap[i][j] = splat(0);
+
+	for (i = 0; i < NUM_AXIS; i++) {
+		for (j = 0; j < NUM_AXIS; j++)
+			d->remap[d->map[i]][j] = splat(0);
+		d->remap[d->map[i]][i] = splat(d->sign[i]);
+	}
+}
+
+/* map and sign are only used at EV_SYN, so this is a sample boundary */
+static void config_reload_sensor_map(struct sensors_config_notifier *n)
+{
+	struct sensor_desc *d = container_of(n, struct sensor_desc,
+					     config_notifier);
+
+	config_read_sensor_map(d);
+	build_remap(d);
+}
+
 static int store_str_attr(struct sensor_desc *d, const char *attr,
 			const char *val)
 {
@@ -167,6 +205,9 @@ int sensor_xyz_init(struct sensor_api_t *s_api)
 		*d->phys_path = 0;
 	}
 	config_read_sensor_map(d);
+	build_remap(d);
+	d->config_notifier.reload = config_reload_sensor_map;
+	sensors_config_register_notifier(&d->config_notifier);
 
 	if (d->dev_attr_mode) {
 		rc = store_str_attr(d, d->dev_attr_mode,
@@ -245,6 +286,7 @@ int sensor_xyz_activate(struct sensor_api_t *s, int enable)
 				__func__, d->sensor.name);
 			return fd;
 		}
+		d->kernel_clock = input_set_kernel_clock(fd);
 		d->select_worker.set_fd(&d->select_worker, fd);
 		d->select_worker.resume(&d->select_worker);
 	} else if (!enable && fd >= 0) {
@@ -255,19 +297,64 @@ int sensor_xyz_activate(struct sensor_api_t *s, int enable)
 	return 0;
 }
 
+/* remap all frames of the batch, four at a time, and hand them on */
+static void flush_batch(struct sensor_desc *p)
+{
+	struct sensor_xyz_batch *b = &p->batch;
+	struct sensor_data_t sd[XYZ_BATCH];
+	v4si out[NUM_AXIS][XYZ_BATCH / 4];
+	int data[XYZ_BATCH][NUM_AXIS];
+	int64_t shift = 0;
+	int64_t now;
+	int i, j;
+
+	if (!b->n)
+		return;
+
+	for (i = 0; i < (b->n + 3) / 4; i++) {
+		for (j = 0; j < NUM_AXIS; j++)
+			out[j][i] = p->remap[j][AXIS_X] * b->x[i] +
+				    p->remap[j][AXIS_Y] * b->y[i] +
+				    p->remap[j][AXIS_Z] * b->z[i];
+	}
+
+	/* without a kernel clock, keep only the spacing of event times */
+	now = get_current_nano_time();
+	if (!p->kernel_clock)
+		shift = now - b->time[b->n - 1];
+	for (i = 0; i < b->n; i++) {
+		for (j = 0; j < NUM_AXIS; j++)
+			data[i][j] = out[j][i / 4][i % 4];
+		sd[i].sensor = &p->sensor;
+		sd[i].data = data[i];
+		sd[i].size = NUM_AXIS;
+		sd[i].scale = p->scale;
+		sd[i].status = SENSOR_STATUS_ACCURACY_HIGH;
+		sd[i].timestamp = shift + b->time[i];
+		sd[i].delay = p->applied_delay_ms;
+		if (p->kernel_clock)
+			sensors_stats_latency(p->sensor.handle, STATS_READ,
+					      now - b->time[i]);
+	}
+	sensors_wrapper_data_batch(sd, b->n);
+	b->n = 0;
+}
+
 void *sensor_xyz_read(void *arg)
 {
 	struct input_event events[MAX_EVENTS];
 	struct input_event *e;
 	struct sensor_desc *p = arg;
-	struct sensor_data_t sd;
+	struct sensor_xyz_batch *b = &p->batch;
 	int fd = p->select_worker.get_fd(&p->select_worker);
 	int i, n;
 
 	if (fd < 0)
 		return NULL;
 
+	TRACE_BEGIN("evdev_read");
 	n = read(fd, events, sizeof(events));
+	TRACE_END();
 	if (n < 0) {
 		ALOGE("%s: read error '%s' from fd %d sensor '%s' built %s @ %s",
 			__func__, strerror(errno), fd, p->sensor.name,
@@ -279,28 +366,28 @@ void *sensor_xyz_read(void *arg)
 		return NULL;
 	}
 
+	TRACE_BEGIN("xyz_parse");
 	n = n / sizeof(events[0]);
 	for (i = 0; i < n; i++) {
 		e = events + i;
 		if (e->type == p->ev_type_data) {
 			if (e->code == p->ev_code[AXIS_X])
-				p->data[p->map[AXIS_X]] =
-					e->value * p->sign[AXIS_X];
+				p->raw[AXIS_X] = e->value;
 			else if (e->code == p->ev_code[AXIS_Y])
-				p->data[p->map[AXIS_Y]] =
-					e->value * p->sign[AXIS_Y];
+				p->raw[AXIS_Y] = e->value;
 			else if (e->code == p->ev_code[AXIS_Z])
-				p->data[p->map[AXIS_Z]] =
-					e->value * p->sign[AXIS_Z];
+				p->raw[AXIS_Z] = e->value;
 		} else if (e->type == p->ev_type_sync) {
-			sd.sensor = &p->sensor;
-			sd.data = p->data;
-			sd.size = NUM_AXIS;
-			sd.scale = p->scale;
-			sd.status = SENSOR_STATUS_ACCURACY_HIGH;
-			sensors_wrapper_data(&sd);
+			b->x[b->n / 4][b->n % 4] = p->raw[AXIS_X];
+			b->y[b->n / 4][b->n % 4] = p->raw[AXIS_Y];
+			b->z[b->n / 4][b->n % 4] = p->raw[AXIS_Z];
+			b->time[b->n] = input_event_time(e);
+			if (++b->n == XYZ_BATCH)
+				flush_batch(p);
 		}
 	}
+	flush_batch(p);
+	TRACE_END();
 
 	return NULL;
 }
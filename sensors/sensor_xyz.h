@@ -31,14 +31,17 @@
 #include "sensor_util.h"
 #include "sensors_id.h"
 #include "sensors_config.h"
+#include "sensors_root.h"
 #include "sensors_wrapper.h"
 #include "sensors_sysfs.h"
 #include "sensor_api.h"
 
 #define PHYS_PATH_BASE "/sys/bus/i2c/devices"
-#define PHYS_PATH_LEN  (sizeof(PHYS_PATH_BASE) + sizeof("/0-0000/"))
+#define PHYS_PATH_LEN  (SENSORS_ROOT_MAX + sizeof(PHYS_PATH_BASE) + \
+			sizeof("/0-0000/"))
 #define ATTR_NAME_LEN  32
-#define DEV_PATH_LEN  sizeof("/dev/input/event/4294967295")
+#define DEV_PATH_LEN  (SENSORS_ROOT_MAX + \
+			sizeof("/dev/input/event/4294967295"))
 
 enum android_rates {
 	RATE_GAME   =  20,
@@ -61,17 +64,35 @@ enum {
 	NUM_AXIS
 };
 
+/* frames decoded by one read, a multiple of the vector width */
+#define XYZ_BATCH 16
+
+typedef int v4si __attribute__((vector_size(16)));
+
+/* decoded raw frames, structure of arrays for the remap kernel */
+struct sensor_xyz_batch {
+	v4si x[XYZ_BATCH / 4];
+	v4si y[XYZ_BATCH / 4];
+	v4si z[XYZ_BATCH / 4];
+	int64_t time[XYZ_BATCH];
+	int n;
+};
+
 struct sensor_desc {
 	struct sensor_t sensor;
 	struct sensor_api_t api;
 	struct wrapper_entry entry;
 	struct sensors_select_t select_worker;
 	struct sensors_sysfs_t sysfs;
-	int data[NUM_AXIS];
+	struct sensors_config_notifier config_notifier;
+	struct sensor_xyz_batch batch;
+	v4si remap[NUM_AXIS][NUM_AXIS];
+	int raw[NUM_AXIS];
 	char *map_prefix;
 	int map[NUM_AXIS];
 	int sign[NUM_AXIS];
 	int applied_delay_ms;
+	int kernel_clock;		/* event times are on the HAL clock */
 	float scale;
 	void * (*read)(void *);
 	int (*find_input)(struct sensor_desc *d);
@@ -290,9 +290,8 @@ static void ak0991xna_compass_data(
     struct wrapper_desc *d = container_of(s, struct wrapper_desc, api);
     sensors_event_t     data;
     int                 err;
-    int32_t             vec[6];
+    float               vec[6];
     int32_t             st;
-    struct AKL_SCL_PRMS *mem;
 
     memset(&data, 0, sizeof(data));
 
@@ -303,18 +302,17 @@ static void ak0991xna_compass_data(
         /* So cannot use here */
         data.timestamp = sd->timestamp;
         /* 0,1,2: magnetic vector,  3,4,5: bias */
-        mem = AKL_DASH_Lock();
-        err = AKL_GetVector(AKM_VT_MAG, mem, vec, 6, &st);
-        AKL_DASH_Unlock();
+        /* published by the base module, no need to lock the library */
+        err = AKL_DASH_GetVectorF(AKM_VT_MAG, vec, 6, &st);
 
         if (err) {
-            ALOGE("%s,%d: AKL_GetVector Error (%d)!",
+            ALOGE("%s,%d: AKL_DASH_GetVectorF Error (%d)!",
                   __func__, __LINE__, err);
         } else {
             if (akm3d.enable_mask & (1 << MAGNETIC)) {
-                data.magnetic.x = vec[0] / 65536.0f;
-                data.magnetic.y = vec[1] / 65536.0f;
-                data.magnetic.z = vec[2] / 65536.0f;
+                data.magnetic.x = vec[0];
+                data.magnetic.y = vec[1];
+                data.magnetic.z = vec[2];
                 data.magnetic.status = st;
                 data.version = akm3d.magnetic.sensor.version;
                 data.sensor = akm3d.magnetic.sensor.handle;
@@ -323,15 +321,12 @@ static void ak0991xna_compass_data(
             }
 
             if (akm3d.enable_mask & (1 << MAGNETIC_UNCALIB)) {
-                data.uncalibrated_magnetic.x_uncalib =
-                    (vec[0] + vec[3]) / 65536.0f;
-                data.uncalibrated_magnetic.y_uncalib =
-                    (vec[1] + vec[4]) / 65536.0f;
-                data.uncalibrated_magnetic.z_uncalib =
-                    (vec[2] + vec[5]) / 65536.0f;
-                data.uncalibrated_magnetic.x_bias = vec[3] / 65536.0f;
-                data.uncalibrated_magnetic.y_bias = vec[4] / 65536.0f;
-                data.uncalibrated_magnetic.z_bias = vec[5] / 65536.0f;
+                data.uncalibrated_magnetic.x_uncalib = vec[0] + vec[3];
+                data.uncalibrated_magnetic.y_uncalib = vec[1] + vec[4];
+                data.uncalibrated_magnetic.z_uncalib = vec[2] + vec[5];
+                data.uncalibrated_magnetic.x_bias = vec[3];
+                data.uncalibrated_magnetic.y_bias = vec[4];
+                data.uncalibrated_magnetic.z_bias = vec[5];
                 data.version = akm3d.magnetic_uncalib.sensor.version;
                 data.sensor = akm3d.magnetic_uncalib.sensor.handle;
                 data.type = akm3d.magnetic_uncalib.sensor.type;
@@ -85,6 +85,7 @@ struct akm_t {
 	struct wrapper_desc magnetic;
 	struct wrapper_desc compass;
 	int64_t delay_requests[NUMSENSORS];
+	struct sensors_config_notifier config_notifier;
 };
 
 static int ak896x_init(struct sensor_api_t *s);
@@ -267,14 +268,57 @@ err_exit:
 	return err;
 }
 
-static int ak896x_init(struct sensor_api_t *s)
+static int ak896x_lib_init(void)
 {
 	register_map_ak896x regs;
 	int16_t mag_layout[MAG_LAYOUT_ROW][MAG_LAYOUT_CLM] = {{1,0,0},{0,1,0},{0,0,1}};
 	int i;
 	int j;
 	int k = 0;
+	int rc;
+
+	ak896x_read_regs(&regs);
+
+	for (i = 0; i < MAG_LAYOUT_ROW; i++) {
+		for (j = 0; j < MAG_LAYOUT_CLM; j++) {
+			mag_layout[i][j] = akm.layout[k];
+			k++;
+		}
+	}
+
+	rc = AKM_Init(AK896X_MAXFORM, &regs,
+			(const int16_t (*)[MAG_LAYOUT_CLM])mag_layout);
+	if (rc)
+		ALOGE("%s: AKM_Init Error !\n", __func__);
+
+	return rc;
+}
+
+/*
+ * The layout is only passed to the library by AKM_Init(). Called with
+ * wrapper_mutex held, so restarting the library here happens between two
+ * samples and the Android sensors stay enabled. The calibration survives
+ * through the setting file.
+ */
+static void ak896x_reload_layout(struct sensors_config_notifier *n)
+{
+	int old[NUM_LAYOUT];
 
+	memcpy(old, akm.layout, sizeof(old));
+	ak896x_read_sensor_layout(&akm);
+	if (!memcmp(old, akm.layout, sizeof(old)) || akm.init_ret)
+		return;
+
+	if (akm.enable_mask)
+		AKM_Stop(SETTING_FILE_NAME);
+	AKM_Release();
+	akm.init_ret = ak896x_lib_init();
+	if (!akm.init_ret && akm.enable_mask)
+		AKM_Start(SETTING_FILE_NAME);
+}
+
+static int ak896x_init(struct sensor_api_t *s)
+{
 	if (!akm.init) {
 		akm.init = 1;
 		akm.init_ret = sensors_wrapper_init(&akm.ak896x.api);
@@ -282,20 +326,11 @@ static int ak896x_init(struct sensor_api_t *s)
 			ALOGE("%s: init failed", __func__);
 			return akm.init_ret;
 		}
-		ak896x_read_regs(&regs);
 		ak896x_read_sensor_layout(&akm);
+		akm.init_ret = ak896x_lib_init();
 
-		for (i = 0; i < MAG_LAYOUT_ROW; i++) {
-			for (j = 0; j < MAG_LAYOUT_CLM; j++) {
-				mag_layout[i][j] = akm.layout[k];
-				k++;
-			}
-		}
-
-		akm.init_ret = AKM_Init(AK896X_MAXFORM, &regs,
-				(const int16_t (*)[MAG_LAYOUT_CLM])mag_layout);
-		if (akm.init_ret)
-			ALOGE("%s: AKM_Init Error !\n", __func__);
+		akm.config_notifier.reload = ak896x_reload_layout;
+		sensors_config_register_notifier(&akm.config_notifier);
 	}
 
 	return akm.init_ret;
@@ -35,7 +35,9 @@
 #include "sensors_list.h"
 #include "sensors_log.h"
 #include "sensors_select.h"
+#include "sensors_stats.h"
 #include "sensors_sysfs.h"
+#include "sensors_trace.h"
 #include "sensors_wrapper.h"
 
 #include "libs/libakm/AKL_APIs.h"
@@ -43,10 +45,13 @@
 #include "libs/libakm/linux/ak0991x.h"
 
 #define CLIENT_DELAY_UNUSED  NO_RATE
-#define GRAV_Q16             642688
+/* samples handed to the library per call */
+#define AKM6D_BATCH          16
 
 enum {
     ORIENTATION,
+    ROTATION_VECTOR,
+    GEOMAGNETIC_ROTATION_VECTOR,
     NUMSENSORS
 };
 
@@ -58,7 +63,11 @@ struct akm6d_t {
     struct wrapper_desc akm6d;
     /* android sensors */
     struct wrapper_desc orientation;
+    struct wrapper_desc rotation_vector;
+    struct wrapper_desc geomagnetic_rotation_vector;
     int64_t             delay_requests[NUMSENSORS];
+    /* timestamp at which each output is due next */
+    int64_t             next_report[NUMSENSORS];
 };
 
 static int akm6d_init(
@@ -81,7 +90,8 @@ static void akm6d_close(
 
 static void akm6d_sensors_data(
     struct sensor_api_t  *s,
-    struct sensor_data_t *sd
+    struct sensor_data_t *sd,
+    int                  n
 );
 
 struct akm6d_t akm6d = {
@@ -100,14 +110,21 @@ struct akm6d_t akm6d = {
             .activate = akm6d_activate,
             .set_delay = akm6d_delay,
             .close = akm6d_close,
-            .data = akm6d_sensors_data,
+            .data_batch = akm6d_sensors_data,
         },
         .access = {
             .match = {
                 SENSOR_TYPE_ACCELEROMETER,
                 SENSOR_TYPE_MAGNETIC_FIELD,
+#ifdef AKMOSS_GYRO
+                SENSOR_TYPE_GYROSCOPE,
+#endif
             },
+#ifdef AKMOSS_GYRO
+            .m_nr = 3,
+#else
             .m_nr = 2,
+#endif
         },
     },
     .orientation = {
@@ -129,9 +146,48 @@ struct akm6d_t akm6d = {
             .close = akm6d_close,
         },
     },
+    .rotation_vector = {
+        .sensor = {
+            name: "AKM OSS Rotation Vector",
+            vendor: "Asahi Kasei Corp.",
+            version: sizeof(sensors_event_t),
+            handle: SENSOR_ROTATION_VECTOR_HANDLE,
+            type: SENSOR_TYPE_ROTATION_VECTOR,
+            maxRange: 1,
+            resolution: 1.0f / 65536,
+            power: 0.8,
+            minDelay: 5000,
+        },
+        .api = {
+            .init = akm6d_init,
+            .activate = akm6d_activate,
+            .set_delay = akm6d_delay,
+            .close = akm6d_close,
+        },
+    },
+    .geomagnetic_rotation_vector = {
+        .sensor = {
+            name: "AKM OSS Geomagnetic Rotation Vector",
+            vendor: "Asahi Kasei Corp.",
+            version: sizeof(sensors_event_t),
+            handle: SENSOR_GEOMAGNETIC_ROTATION_VECTOR_HANDLE,
+            type: SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR,
+            maxRange: 1,
+            resolution: 1.0f / 65536,
+            power: 0.8,
+            minDelay: 5000,
+        },
+        .api = {
+            .init = akm6d_init,
+            .activate = akm6d_activate,
+            .set_delay = akm6d_delay,
+            .close = akm6d_close,
+        },
+    },
     .delay_requests = {
         CLIENT_DELAY_UNUSED,
         CLIENT_DELAY_UNUSED,
+        CLIENT_DELAY_UNUSED,
     },
 };
 
@@ -173,6 +229,14 @@ static int akm6d_activate(
         sensor = ORIENTATION;
         break;
 
+    case SENSOR_ROTATION_VECTOR_HANDLE:
+        sensor = ROTATION_VECTOR;
+        break;
+
+    case SENSOR_GEOMAGNETIC_ROTATION_VECTOR_HANDLE:
+        sensor = GEOMAGNETIC_ROTATION_VECTOR;
+        break;
+
     default:
         ALOGE("%s: Should not reach here.", __func__);
         return -1;
@@ -183,6 +247,8 @@ static int akm6d_activate(
         prev_en = akm6d.enable_mask;
         /* set flag */
         akm6d.enable_mask |= (1 << sensor);
+        /* report on the first sample */
+        akm6d.next_report[sensor] = 0;
 
         /* If other sensor was already activated, skip wrapper */
         if (prev_en > 0) {
@@ -223,6 +289,14 @@ static int akm6d_delay(
         sensor = ORIENTATION;
         break;
 
+    case SENSOR_ROTATION_VECTOR_HANDLE:
+        sensor = ROTATION_VECTOR;
+        break;
+
+    case SENSOR_GEOMAGNETIC_ROTATION_VECTOR_HANDLE:
+        sensor = GEOMAGNETIC_ROTATION_VECTOR;
+        break;
+
     default:
         return sensor;
     }
@@ -254,38 +328,148 @@ static void akm6d_close(struct sensor_api_t *s)
     }
 }
 
+static const int akm6d_handle[NUMSENSORS] = {
+    SENSOR_ORIENTATION_HANDLE,
+    SENSOR_ROTATION_VECTOR_HANDLE,
+    SENSOR_GEOMAGNETIC_ROTATION_VECTOR_HANDLE,
+};
+
+/* Outputs whose requested period has elapsed at time ts, the last of
+ * n inputs. Their next deadline is advanced by one period, so the rate
+ * holds on average even though reports can only fall on input runs. */
+static unsigned int akm6d_due(int64_t ts, int n)
+{
+    unsigned int due = 0;
+    int64_t      period;
+    int          i;
+
+    for (i = 0; i < NUMSENSORS; i++) {
+        if (!(akm6d.enable_mask & (1 << i))) {
+            continue;
+        }
+
+        /* the input is folded into the next report of this output */
+        if (ts < akm6d.next_report[i]) {
+            sensors_stats_coalesced(akm6d_handle[i], n);
+            continue;
+        }
+
+        /* the earlier inputs of the run are folded into this report */
+        if (n > 1) {
+            sensors_stats_coalesced(akm6d_handle[i], n - 1);
+        }
+
+        period = akm6d.delay_requests[i];
+
+        if (period == CLIENT_DELAY_UNUSED) {
+            period = 0;
+        }
+
+        akm6d.next_report[i] += period;
+
+        /* first report, or we fell behind by more than a period */
+        if (akm6d.next_report[i] <= ts) {
+            akm6d.next_report[i] = ts + period;
+        }
+
+        due |= (1 << i);
+    }
+
+    return due;
+}
+
+static void akm6d_put_quat(
+    sensors_event_t     *data,
+    const float         vec[4],
+    int                 sensor,
+    unsigned int        due,
+    struct wrapper_desc *d)
+{
+    int i;
+
+    if (!(due & (1 << sensor))) {
+        return;
+    }
+
+    /* (x, y, z, w), heading accuracy unknown */
+    for (i = 0; i < 4; i++) {
+        data->data[i] = vec[i];
+    }
+
+    data->data[4] = -1;
+    data->version = d->sensor.version;
+    data->sensor = d->sensor.handle;
+    data->type = d->sensor.type;
+    sensors_fifo_put(data);
+}
+
+/* Hand a run of samples of one sensor to the library in one call */
+static int16_t akm6d_set(
+    struct AKL_SCL_PRMS        *mem,
+    const struct sensor_data_t *sd,
+    int                        n,
+    AKM_SENSOR_TYPE            stype,
+    float                      unit)
+{
+    struct AKM_SENSOR_DATA_F akm_data[AKM6D_BATCH];
+    int16_t                  err;
+    int                      i, k;
+
+    for (; n > 0; n -= k, sd += k) {
+        k = (n < AKM6D_BATCH) ? n : AKM6D_BATCH;
+
+        for (i = 0; i < k; i++) {
+            akm_data[i].u.s.x = (sd[i].data[AXIS_X] * sd[i].scale) * unit;
+            akm_data[i].u.s.y = (sd[i].data[AXIS_Y] * sd[i].scale) * unit;
+            akm_data[i].u.s.z = (sd[i].data[AXIS_Z] * sd[i].scale) * unit;
+            akm_data[i].stype = stype;
+            akm_data[i].time_us = sd[i].timestamp / 1000;
+        }
+
+        err = AKL_SetVectorF(mem, akm_data, k);
+
+        if (err) {
+            return err;
+        }
+    }
+
+    return AKM_SUCCESS;
+}
+
+/* all n samples come from the same sensor, see sensors_wrapper_data_batch */
 static void akm6d_sensors_data(
     struct sensor_api_t  *s,
-    struct sensor_data_t *sd)
+    struct sensor_data_t *sd,
+    int                  n)
 {
     /* update flag */
-    static int             up_a = 0;
-    static int             up_m = 0;
-    struct wrapper_desc    *d = container_of(s, struct wrapper_desc, api);
-    sensors_event_t        data;
-    int                    err;
-    struct AKM_SENSOR_DATA akm_data;
-    int32_t                vec[6];
-    int32_t                st;
-    struct AKL_SCL_PRMS    *mem;
+    static int               up_a = 0;
+    static int               up_m = 0;
+#ifdef AKMOSS_GYRO
+    static int               up_g = 0;
+#endif
+    sensors_event_t          data;
+    int                      err;
+    float                    vec[6];
+    int32_t                  st;
+    unsigned int             report;
+    uint32_t                 vtypes;
+    struct AKL_SCL_PRMS      *mem;
+    int64_t                  timestamp = sd[n - 1].timestamp;
 
     memset(&data, 0, sizeof(data));
 
     mem = AKL_DASH_Lock();
 
     if (sd->sensor->type == SENSOR_TYPE_ACCELEROMETER) {
-        akm_data.u.s.x = (sd->data[AXIS_X] * sd->scale) * GRAV_Q16;
-        akm_data.u.s.y = (sd->data[AXIS_Y] * sd->scale) * GRAV_Q16;
-        akm_data.u.s.z = (sd->data[AXIS_Z] * sd->scale) * GRAV_Q16;
-        akm_data.stype = AKM_ST_ACC;
-        akm_data.time_us = sd->timestamp / 1000;
-        err = AKL_SetVector(mem, &akm_data, 1);
+        err = akm6d_set(mem, sd, n, AKM_ST_ACC, GRAVITY_EARTH);
 
         if (err && (AKM_ERR_NOT_SUPPORT != err)) {
-            ALOGE("%s,%d: AKL_SetVector Error (%d)!",
+            ALOGE("%s,%d: AKL_SetVectorF Error (%d)!",
                   __func__, __LINE__, err);
         } else {
             up_a = 1;
+            AKL_DASH_Publish(mem, AKM_VT_ACC);
         }
     }
 
@@ -293,39 +477,114 @@ static void akm6d_sensors_data(
         up_m = 1;
     }
 
-    /* Calculation */
-    err = AKL_CalcFusion(mem);
+#ifdef AKMOSS_GYRO
+    if (sd->sensor->type == SENSOR_TYPE_GYROSCOPE) {
+        err = akm6d_set(mem, sd, n, AKM_ST_GYR, 1.0f);
 
-    if (err != AKM_SUCCESS) {
-        ALOGE("AKL_CalcFusion failed (%d).", err);
+        if (err) {
+            ALOGE("%s,%d: AKL_SetVectorF Error (%d)!",
+                  __func__, __LINE__, err);
+        } else {
+            up_g = 1;
+        }
     }
+#endif
 
     /* fusion sensors */
-    if (up_a && up_m) {
-        data.timestamp = sd->timestamp;
-
-        if (akm6d.enable_mask & (1 << ORIENTATION)) {
-            err = AKL_GetVector(AKM_VT_ORI, mem, vec, 3, &st);
-
-            if (err) {
-                ALOGE("%s,%d: AKL_GetVector Error (%d)!",
-                      __func__, __LINE__, err);
-            } else {
-                data.magnetic.azimuth = vec[0] / 65536.0f;
-                data.magnetic.pitch = vec[1] / 65536.0f;
-                data.magnetic.roll = vec[2] / 65536.0f;
-                data.version = akm6d.orientation.sensor.version;
-                data.sensor = akm6d.orientation.sensor.handle;
-                data.type = akm6d.orientation.sensor.type;
-                sensors_fifo_put(&data);
-            }
+#ifdef AKMOSS_GYRO
+    /* follow the gyroscope rate once acc and mag have been seen */
+    report = up_g && up_a && up_m;
+#else
+    report = up_a && up_m;
+#endif
+
+    /* the inputs above are only buffered, direction is worked out
+     * when an enabled output is due */
+    if (report) {
+        report = akm6d_due(timestamp, n);
+    }
+
+    if (report) {
+        TRACE_BEGIN("akm_fusion");
+        err = AKL_CalcFusion(mem);
+        TRACE_END();
+
+        if (err != AKM_SUCCESS) {
+            ALOGE("AKL_CalcFusion failed (%d).", err);
+        }
+
+        vtypes = 0;
+
+        if (report & (1 << ORIENTATION)) {
+            vtypes |= AKM_VT_ORI;
         }
 
+        if (report & (1 << ROTATION_VECTOR)) {
+            vtypes |= AKM_VT_QUAT;
+        }
+
+        /* never the gyro-fused one, geomagnetic must not drift with it */
+        if (report & (1 << GEOMAGNETIC_ROTATION_VECTOR)) {
+            vtypes |= AKM_VT_GEOQUAT;
+        }
+
+        AKL_DASH_Publish(mem, vtypes);
+#ifdef AKMOSS_GYRO
+        up_g = 0;
+#else
         up_a = up_m = 0;
+#endif
     }
 
-exit:
     AKL_DASH_Unlock();
+
+    /* the published snapshot is read without holding the library */
+    if (!report) {
+        return;
+    }
+
+    data.timestamp = timestamp;
+
+    if (report & (1 << ORIENTATION)) {
+        err = AKL_DASH_GetVectorF(AKM_VT_ORI, vec, 3, &st);
+
+        if (err) {
+            ALOGE("%s,%d: AKL_DASH_GetVectorF Error (%d)!",
+                  __func__, __LINE__, err);
+        } else {
+            data.magnetic.azimuth = vec[0];
+            data.magnetic.pitch = vec[1];
+            data.magnetic.roll = vec[2];
+            data.version = akm6d.orientation.sensor.version;
+            data.sensor = akm6d.orientation.sensor.handle;
+            data.type = akm6d.orientation.sensor.type;
+            sensors_fifo_put(&data);
+        }
+    }
+
+    if (report & (1 << ROTATION_VECTOR)) {
+        err = AKL_DASH_GetVectorF(AKM_VT_QUAT, vec, 4, &st);
+
+        if (err) {
+            ALOGE("%s,%d: AKL_DASH_GetVectorF Error (%d)!",
+                  __func__, __LINE__, err);
+        } else {
+            akm6d_put_quat(&data, vec, ROTATION_VECTOR, report,
+                           &akm6d.rotation_vector);
+        }
+    }
+
+    if (report & (1 << GEOMAGNETIC_ROTATION_VECTOR)) {
+        err = AKL_DASH_GetVectorF(AKM_VT_GEOQUAT, vec, 4, &st);
+
+        if (err) {
+            ALOGE("%s,%d: AKL_DASH_GetVectorF Error (%d)!",
+                  __func__, __LINE__, err);
+        } else {
+            akm6d_put_quat(&data, vec, GEOMAGNETIC_ROTATION_VECTOR, report,
+                           &akm6d.geomagnetic_rotation_vector);
+        }
+    }
 }
 
 list_constructor(akm6d_register);
@@ -334,4 +593,10 @@ void akm6d_register()
     (void)sensors_list_register(
         &akm6d.orientation.sensor,
         &akm6d.orientation.api);
+    (void)sensors_list_register(
+        &akm6d.rotation_vector.sensor,
+        &akm6d.rotation_vector.api);
+    (void)sensors_list_register(
+        &akm6d.geomagnetic_rotation_vector.sensor,
+        &akm6d.geomagnetic_rotation_vector.api);
 }
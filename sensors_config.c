@@ -18,179 +18,754 @@
 
 #include <stdio.h>
 #include "sensors_log.h"
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "sensors_config.h"
+#include "sensors_root.h"
 
 #define PRIMARY_CONFIG "/etc/dash.conf"
 #define SECONDARY_CONFIG "/etc/sensors.conf"
+#define BINARY_SUFFIX ".bin"
 
-#define MAX_STR_LEN 64
+#define CONFIG_MAGIC 0x48534144 /* "DASH" */
+#define CONFIG_VERSION 3
+
+/*
+ * The parsed configuration is kept in one flat image:
+ *
+ *   header | entries | hash slots | int table | string table
+ *
+ * All references inside the image are offsets, never pointers. Every value
+ * is converted to int, int array and string when the file is loaded so that
+ * a lookup is a hash probe followed by a copy.
+ *
+ * The same image is written to <config>.bin by sensors_config_compile() and
+ * mapped read-only by sensors_config_read(), so the pages are shared by all
+ * processes loading the HAL. The image is stored in host byte order, host
+ * and target are both expected to be little endian.
+ *
+ * A mapped file that is truncated or rewritten in place faults the reader
+ * with SIGBUS, so the .bin must only ever be replaced by rename(), as
+ * sensors_config_compile() does.
+ */
 struct config_entry_t {
-	char prefix[MAX_STR_LEN];
-	char key[MAX_STR_LEN];
-	char value[MAX_STR_LEN];
-	struct config_entry_t *next;
+	uint32_t prefix;	/* string table offset */
+	uint32_t key;		/* string table offset */
+	uint32_t str;		/* string table offset */
+	uint32_t str_len;	/* excluding the terminating zero */
+	uint32_t hash;
+	int32_t value;		/* TYPE_INT */
+	uint32_t array;		/* int table index */
+	int32_t array_len;	/* TYPE_ARRAY_INT */
+};
+
+struct config_image_t {
+	uint32_t magic;
+	uint32_t checksum;	/* of everything following this field */
+	uint32_t version;
+	uint32_t size;
+	uint32_t src_size;	/* text it was compiled from, 0 if none */
+	uint32_t src_mtime;
+	uint32_t src_mtime_nsec;
+	uint32_t nr_entries;
+	uint32_t nr_slots;	/* power of two */
+	uint32_t entries_off;
+	uint32_t slots_off;	/* entry index + 1, 0 is an empty slot */
+	uint32_t ints_off;
+	uint32_t strings_off;
 };
 
-static struct config_entry_t *config_list;
+struct config_line_t {
+	const char *prefix;
+	const char *key;
+	const char *value;
+	unsigned int prefix_len;
+	unsigned int key_len;
+	unsigned int value_len;
+	unsigned int array_len;
+};
+
+/*
+ * config may be swapped by sensors_config_reload() at any time, so it is
+ * only accessed with config_mutex held and values are copied out.
+ */
+static struct config_image_t *config;
+static int config_mapped;
+static char config_path[PATH_MAX];
+static pthread_mutex_t config_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct sensors_config_notifier *notifiers;
+
+static uint32_t config_hash(const char *prefix, unsigned int prefix_len,
+			    const char *key, unsigned int key_len)
+{
+	uint32_t h = 2166136261u;
+	unsigned int i;
+
+	for (i = 0; i < prefix_len; i++)
+		h = (h ^ (unsigned char)prefix[i]) * 16777619u;
+	h = (h ^ '_') * 16777619u;
+	for (i = 0; i < key_len; i++)
+		h = (h ^ (unsigned char)key[i]) * 16777619u;
+
+	return h;
+}
+
+static uint32_t image_checksum(const struct config_image_t *img, size_t size)
+{
+	const unsigned char *p = (const unsigned char *)&img->version;
+	const unsigned char *end = (const unsigned char *)img + size;
+	uint32_t h = 2166136261u;
+
+	while (p < end)
+		h = (h ^ *p++) * 16777619u;
+
+	return h;
+}
+
+#define image_ptr(img, off) ((char *)(img) + (off))
 
-static void insert_entry(struct config_entry_t *entry)
+static inline struct config_entry_t *image_entries(
+					const struct config_image_t *img)
 {
-	struct config_entry_t *p = config_list;
+	return (struct config_entry_t *)image_ptr(img, img->entries_off);
+}
+
+static inline uint32_t *image_slots(const struct config_image_t *img)
+{
+	return (uint32_t *)image_ptr(img, img->slots_off);
+}
+
+static inline int32_t *image_ints(const struct config_image_t *img)
+{
+	return (int32_t *)image_ptr(img, img->ints_off);
+}
+
+static inline char *image_strings(const struct config_image_t *img)
+{
+	return image_ptr(img, img->strings_off);
+}
 
-	if (!config_list) {
-		config_list = entry;
-		config_list->next = NULL;
-		return;
+static const struct config_entry_t *image_lookup(
+				const struct config_image_t *img,
+				const char *prefix, unsigned int prefix_len,
+				const char *key, unsigned int key_len,
+				uint32_t hash)
+{
+	const struct config_entry_t *entries = image_entries(img);
+	const uint32_t *slots = image_slots(img);
+	const char *strings = image_strings(img);
+	uint32_t mask = img->nr_slots - 1;
+	uint32_t i;
+
+	for (i = hash & mask; slots[i]; i = (i + 1) & mask) {
+		const struct config_entry_t *e = &entries[slots[i] - 1];
+
+		if (e->hash == hash &&
+		    !strncmp(strings + e->prefix, prefix, prefix_len) &&
+		    !strings[e->prefix + prefix_len] &&
+		    !strncmp(strings + e->key, key, key_len) &&
+		    !strings[e->key + key_len])
+			return e;
 	}
+	return NULL;
+}
 
-	while (p) {
-		if (!p->next) {
-			p->next = entry;
-			p->next->next = NULL;
-			return;
+static char *read_file(FILE *fp, size_t *len)
+{
+	char *buf = NULL;
+	size_t size = 0;
+	size_t n = 0;
+
+	do {
+		char *p;
+
+		if (n == size) {
+			size = size ? size * 2 : 1024;
+			p = realloc(buf, size + 1);
+			if (!p) {
+				free(buf);
+				return NULL;
+			}
+			buf = p;
+		}
+		n += fread(buf + n, 1, size - n, fp);
+	} while (n == size);
+
+	buf[n] = 0;
+	*len = n;
+	return buf;
+}
+
+static unsigned int count_array(const char *value, unsigned int len)
+{
+	unsigned int i;
+	unsigned int n = 0;
+	int in_token = 0;
+
+	/* same tokenization as strtok(value, ",") */
+	for (i = 0; i < len; i++) {
+		if (value[i] == ',') {
+			in_token = 0;
+		} else if (!in_token) {
+			in_token = 1;
+			n++;
 		}
-		p = p->next;
 	}
+	return n;
 }
 
-static int parse_value(char *value, enum config_type_t type, void *out_value,
-		       unsigned int out_size)
+/*
+ * Split one line into <prefix>_<key>[ =]<value>.
+ * Returns 1 on a match, 0 for lines to be skipped and -1 on parse error.
+ */
+static int parse_line(char *line, unsigned int len, struct config_line_t *out)
 {
-	switch (type) {
-	default:
+	char *p = line;
+	char *end = line + len;
+
+	while (p < end && isspace((unsigned char)*p))
+		p++;
+	if (p == end || *p == '#')
+		return 0;
+	while (end > p && isspace((unsigned char)end[-1]))
+		end--;
+
+	out->prefix = p;
+	while (p < end && *p != '_')
+		p++;
+	if (p == end || p == out->prefix)
 		return -1;
+	out->prefix_len = p - out->prefix;
 
-	case TYPE_STRING:
-	{
-		unsigned int bytes;
-		bytes = strlen(value) + 1;
-		if (out_size < bytes)
-			return -1;
+	out->key = ++p;
+	while (p < end && *p != ' ' && *p != '=')
+		p++;
+	if (p == end || p == out->key)
+		return -1;
+	out->key_len = p - out->key;
 
-		memcpy(out_value, value, bytes);
-		break;
+	while (p < end && (*p == ' ' || *p == '='))
+		p++;
+	if (p == end)
+		return -1;
+	out->value = p;
+	out->value_len = end - p;
+	out->array_len = count_array(out->value, out->value_len);
+
+	return 1;
+}
+
+static struct config_image_t *build_image(char *text, size_t text_len)
+{
+	struct config_image_t *img = NULL;
+	struct config_line_t *lines;
+	struct config_entry_t *entries;
+	uint32_t *slots;
+	int32_t *ints;
+	char *strings;
+	unsigned int max_lines = 1;
+	unsigned int nr_lines = 0;
+	unsigned int nr_ints = 0;
+	unsigned int str_size = 0;
+	unsigned int nr_slots = 8;
+	unsigned int i;
+	size_t size;
+	char *p;
+
+	for (i = 0; i < text_len; i++)
+		if (text[i] == '\n')
+			max_lines++;
+
+	lines = malloc(max_lines * sizeof(*lines));
+	if (!lines)
+		return NULL;
+
+	for (p = text; p < text + text_len; ) {
+		char *eol = memchr(p, '\n', text + text_len - p);
+		unsigned int len = eol ? (unsigned int)(eol - p) :
+					(unsigned int)(text + text_len - p);
+		struct config_line_t *l = &lines[nr_lines];
+		int rc;
+
+		rc = parse_line(p, len, l);
+		if (rc < 0) {
+			ALOGE("Parse error: %.*s", len, p);
+			goto exit;
+		}
+		if (rc > 0) {
+			nr_lines++;
+			nr_ints += l->array_len;
+			str_size += l->prefix_len + l->key_len +
+				    l->value_len + 3;
+		}
+		p += len + 1;
 	}
 
-	case TYPE_ARRAY_INT:
-	{
-		char *token;
-		char *saveptr;
-		unsigned int i = 0;
-		char restore[MAX_STR_LEN];
-		unsigned int bytes;
-		bytes = strlen(value) + 1;
-		if (MAX_STR_LEN < bytes)
-			return -1;
-
-		memcpy(restore, value, bytes);
-		token = strtok_r(value, ",", &saveptr);
-		while (token) {
-			((int*)out_value)[i] = atoi(token);
-			if (++i > out_size) {
-				memcpy(value, restore, bytes);
-				return -1;
+	while (nr_slots < 2 * nr_lines)
+		nr_slots <<= 1;
+
+	size = sizeof(*img);
+	size += nr_lines * sizeof(*entries);
+	size += nr_slots * sizeof(*slots);
+	size += nr_ints * sizeof(*ints);
+	size += str_size;
+
+	img = calloc(1, size);
+	if (!img)
+		goto exit;
+
+	img->magic = CONFIG_MAGIC;
+	img->version = CONFIG_VERSION;
+	img->size = size;
+	img->nr_slots = nr_slots;
+	img->entries_off = sizeof(*img);
+	img->slots_off = img->entries_off + nr_lines * sizeof(*entries);
+	img->ints_off = img->slots_off + nr_slots * sizeof(*slots);
+	img->strings_off = img->ints_off + nr_ints * sizeof(*ints);
+
+	entries = image_entries(img);
+	slots = image_slots(img);
+	ints = image_ints(img);
+	strings = image_strings(img);
+	nr_ints = 0;
+	str_size = 0;
+
+	for (i = 0; i < nr_lines; i++) {
+		struct config_line_t *l = &lines[i];
+		struct config_entry_t *e = &entries[img->nr_entries];
+		uint32_t hash = config_hash(l->prefix, l->prefix_len,
+					    l->key, l->key_len);
+		uint32_t slot;
+		unsigned int j;
+		char *value;
+
+		/* first occurrence of a key wins */
+		if (image_lookup(img, l->prefix, l->prefix_len,
+				 l->key, l->key_len, hash))
+			continue;
+
+		e->hash = hash;
+		e->prefix = str_size;
+		memcpy(strings + str_size, l->prefix, l->prefix_len);
+		str_size += l->prefix_len + 1;
+		e->key = str_size;
+		memcpy(strings + str_size, l->key, l->key_len);
+		str_size += l->key_len + 1;
+		e->str = str_size;
+		e->str_len = l->value_len;
+		value = strings + str_size;
+		memcpy(value, l->value, l->value_len);
+		str_size += l->value_len + 1;
+
+		e->value = atoi(value);
+		e->array = nr_ints;
+		e->array_len = 0;
+		for (j = 0; j < l->value_len; j++) {
+			/* same tokenization as count_array() */
+			if (value[j] != ',' && (j == 0 || value[j - 1] == ',')) {
+				ints[nr_ints++] = atoi(value + j);
+				e->array_len++;
 			}
-			token = strtok_r(NULL, ",", &saveptr);
 		}
-		memcpy(value, restore, bytes);
-		break;
+
+		for (slot = hash & (nr_slots - 1); slots[slot];
+		     slot = (slot + 1) & (nr_slots - 1))
+			;
+		slots[slot] = ++img->nr_entries;
 	}
 
-	case TYPE_INT:
-		if (out_size < sizeof(int))
-			return -1;
+	img->checksum = image_checksum(img, size);
 
-		*((int*)out_value) = atoi(value);
-		break;
+exit:
+	free(lines);
+	return img;
+}
+
+static struct config_image_t *parse_file(FILE *fp)
+{
+	struct config_image_t *img;
+	char *text;
+	size_t len;
+
+	text = read_file(fp, &len);
+	if (!text) {
+		ALOGE("%s: unable to read config file", __func__);
+		return NULL;
 	}
-	return 0;
+
+	img = build_image(text, len);
+	free(text);
+	return img;
 }
 
-int sensors_config_read(char* filename)
+static int image_valid(const struct config_image_t *img, size_t size)
+{
+	if (size < sizeof(*img) || img->magic != CONFIG_MAGIC ||
+	    img->version != CONFIG_VERSION || img->size != size)
+		return 0;
+
+	if (!img->nr_slots || (img->nr_slots & (img->nr_slots - 1)) ||
+	    img->nr_entries >= img->nr_slots)
+		return 0;
+
+	if (img->entries_off != sizeof(*img) ||
+	    img->slots_off != img->entries_off +
+			img->nr_entries * sizeof(struct config_entry_t) ||
+	    img->ints_off != img->slots_off + img->nr_slots * sizeof(uint32_t) ||
+	    img->strings_off < img->ints_off || img->strings_off > size)
+		return 0;
+
+	return img->checksum == image_checksum(img, size);
+}
+
+/*
+ * An edit within the same second as the compile leaves st_mtime alone, so
+ * the image records size and nanosecond mtime of its text and only matches
+ * that exact file.
+ */
+static void image_stamp(struct config_image_t *img, const struct stat *st)
+{
+	img->src_size = st->st_size;
+	img->src_mtime = st->st_mtim.tv_sec;
+	img->src_mtime_nsec = st->st_mtim.tv_nsec;
+}
+
+static int image_from(const struct config_image_t *img, const struct stat *st)
+{
+	return img->src_size == (uint32_t)st->st_size &&
+		img->src_mtime == (uint32_t)st->st_mtim.tv_sec &&
+		img->src_mtime_nsec == (uint32_t)st->st_mtim.tv_nsec;
+}
+
+/*
+ * Map <text_path>.bin if it is a valid image compiled from the text
+ * configuration as it is now, or if there is no text configuration.
+ */
+static struct config_image_t *map_image(const char *text_path)
+{
+	char path[PATH_MAX];
+	struct config_image_t *img;
+	struct stat bin_st;
+	struct stat text_st;
+	int fd;
+
+	if (snprintf(path, sizeof(path), "%s" BINARY_SUFFIX, text_path) >=
+	    (int)sizeof(path))
+		return NULL;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+
+	if (fstat(fd, &bin_st) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	img = mmap(NULL, bin_st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (img == MAP_FAILED)
+		return NULL;
+
+	if (!image_valid(img, bin_st.st_size)) {
+		ALOGE("%s: %s is corrupt, ignored", __func__, path);
+		goto err_unmap;
+	}
+
+	if (!stat(text_path, &text_st) && !image_from(img, &text_st)) {
+		ALOGI("%s: %s is not compiled from %s, ignored", __func__,
+		      path, text_path);
+		goto err_unmap;
+	}
+	return img;
+
+err_unmap:
+	munmap(img, bin_st.st_size);
+	return NULL;
+}
+
+/*
+ * Returns 1 if a configuration was loaded, 0 if there is none at path and
+ * -1 if the text configuration could not be parsed.
+ */
+static int load_image(const char *path, struct config_image_t **img,
+		      int *mapped)
 {
 	FILE *fp;
-	char buf[64];
-	int retval = 0;
+
+	*img = map_image(path);
+	if (*img) {
+		*mapped = 1;
+		return 1;
+	}
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+
+	*img = parse_file(fp);
+	*mapped = 0;
+	fclose(fp);
+
+	return *img ? 1 : -1;
+}
+
+static void release_image(struct config_image_t *img, int mapped)
+{
+	if (img && mapped)
+		munmap(img, img->size);
+	else
+		free(img);
+}
+
+static void swap_image(struct config_image_t *img, int mapped,
+		       const char *path)
+{
+	struct config_image_t *old;
+	int old_mapped;
+
+	pthread_mutex_lock(&config_mutex);
+	old = config;
+	old_mapped = config_mapped;
+	config = img;
+	config_mapped = mapped;
+	snprintf(config_path, sizeof(config_path), "%s", path ? path : "");
+	pthread_mutex_unlock(&config_mutex);
+
+	release_image(old, old_mapped);
+}
+
+int sensors_config_read(char* filename)
+{
+	struct config_image_t *img;
+	char root_path[PATH_MAX];
+	char *path;
+	int mapped;
+	int rc;
 
 	if (filename) {
-		fp = fopen(filename, "r");
+		path = filename;
+		rc = load_image(path, &img, &mapped);
 	} else {
-		fp = fopen(PRIMARY_CONFIG, "r");
-		if (!fp)
-			fp = fopen(SECONDARY_CONFIG, "r");
+		path = root_path;
+		snprintf(path, PATH_MAX, "%s" PRIMARY_CONFIG, sensors_root());
+		rc = load_image(path, &img, &mapped);
+		if (!rc) {
+			snprintf(path, PATH_MAX, "%s" SECONDARY_CONFIG,
+				 sensors_root());
+			rc = load_image(path, &img, &mapped);
+		}
 	}
 
-	if (!fp) {
+	if (!rc)
 		ALOGE("%s: unable to open config file", __func__);
+	if (rc <= 0)
 		return -1;
-	}
 
-	while (fgets(buf, sizeof(buf), fp)) {
-		struct config_entry_t *new_entry;
+	swap_image(img, mapped, path);
 
-		if (buf[0] == '#')
-			continue;
+	return 0;
+}
 
-		new_entry = malloc(sizeof(*new_entry));
+int sensors_config_path(char *out, int out_size)
+{
+	int rc = -1;
 
-		if (!new_entry) {
-			retval = -1;
-			goto exit;
-		}
+	pthread_mutex_lock(&config_mutex);
+	if (config_path[0] &&
+	    snprintf(out, out_size, "%s", config_path) < out_size)
+		rc = 0;
+	pthread_mutex_unlock(&config_mutex);
 
-		/* Arguments have length MAX_STR_LEN=64 */
-		if (sscanf(buf, "%64[^_]_%64[^ =]%*[ =]"
-			"%64[^\n]", new_entry->prefix,
-			new_entry->key, new_entry->value) == 3) {
-			insert_entry(new_entry);
-		} else if (sscanf(buf, "%64[^ \n]", new_entry->prefix) == 1) {
-			ALOGE("Parse error: %s", buf);
-			free(new_entry);
-			sensors_config_destroy();
-			retval = -1;
-		} else {
-			free(new_entry);
-		}
+	return rc;
+}
 
+int sensors_config_reload()
+{
+	struct sensors_config_notifier *n, *p;
+	struct config_image_t *img;
+	char path[PATH_MAX];
+	int mapped;
+	int count = 0;
+
+	if (sensors_config_path(path, sizeof(path)) < 0)
+		return -1;
+
+	if (load_image(path, &img, &mapped) <= 0) {
+		ALOGE("%s: failed to reload %s, keeping old config",
+		      __func__, path);
+		return -1;
+	}
+	swap_image(img, mapped, path);
+	ALOGI("%s: reloaded %s", __func__, path);
+
+	/*
+	 * Notifiers read the config, so they are called without the lock.
+	 * The list is only appended to, so the entries counted here and
+	 * their links stay valid while a driver registers another one.
+	 */
+	pthread_mutex_lock(&config_mutex);
+	n = notifiers;
+	for (p = n; p; p = p->next)
+		count++;
+	pthread_mutex_unlock(&config_mutex);
+
+	while (count--) {
+		n->reload(n);
+		if (count)
+			n = n->next;
 	}
 
+	return 0;
+}
+
+void sensors_config_register_notifier(struct sensors_config_notifier *n)
+{
+	struct sensors_config_notifier **p;
+
+	pthread_mutex_lock(&config_mutex);
+	for (p = &notifiers; *p; p = &(*p)->next) {
+		if (*p == n)
+			goto exit;
+	}
+	n->next = NULL;
+	*p = n;
 exit:
+	pthread_mutex_unlock(&config_mutex);
+}
+
+int sensors_config_compile(char* filename, char* out_filename)
+{
+	struct config_image_t *img;
+	char tmp_path[PATH_MAX];
+	struct stat st;
+	FILE *fp;
+	int ret = 0;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		ALOGE("%s: unable to open %s", __func__, filename);
+		return -1;
+	}
+	/* stat before reading, an edit while parsing leaves a stale stamp */
+	if (fstat(fileno(fp), &st) < 0) {
+		ALOGE("%s: unable to stat %s", __func__, filename);
+		fclose(fp);
+		return -1;
+	}
+	img = parse_file(fp);
 	fclose(fp);
+	if (!img)
+		return -1;
+	image_stamp(img, &st);
+	img->checksum = image_checksum(img, img->size);
 
-	return retval;
+	if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", out_filename) >=
+	    (int)sizeof(tmp_path)) {
+		ALOGE("%s: path too long %s", __func__, out_filename);
+		free(img);
+		return -1;
+	}
+
+	/* readers may have the old image mapped, never write it in place */
+	fp = fopen(tmp_path, "wb");
+	if (!fp) {
+		ALOGE("%s: unable to create %s", __func__, tmp_path);
+		free(img);
+		return -1;
+	}
+	if (fwrite(img, img->size, 1, fp) != 1 || fflush(fp) ||
+	    fsync(fileno(fp)))
+		ret = -1;
+	if (fclose(fp))
+		ret = -1;
+	if (!ret && rename(tmp_path, out_filename))
+		ret = -1;
+	if (ret < 0) {
+		ALOGE("%s: unable to write %s", __func__, out_filename);
+		unlink(tmp_path);
+	}
+
+	free(img);
+	return ret;
 }
 
 int sensors_have_config_file()
 {
-	return (config_list != NULL);
+	int rc;
+
+	pthread_mutex_lock(&config_mutex);
+	rc = (config != NULL);
+	pthread_mutex_unlock(&config_mutex);
+
+	return rc;
 }
 
 int sensors_config_get_key(char* prefix, char* key, enum config_type_t type,
 			   void *out_value, int out_size)
 {
-	struct config_entry_t *p = config_list;
+	const struct config_entry_t *e;
+	unsigned int prefix_len;
+	unsigned int key_len;
+	uint32_t hash;
+	int rc = -1;
 
-	while (p) {
-		if ((strncmp(p->prefix, prefix, strlen(p->prefix)) == 0) &&
-		    (strncmp(p->key, key, strlen(p->key)) == 0)) {
-		    return parse_value(p->value, type, out_value, out_size);
-		}
-		p = p->next;
+	prefix_len = strlen(prefix);
+	key_len = strlen(key);
+	hash = config_hash(prefix, prefix_len, key, key_len);
+
+	pthread_mutex_lock(&config_mutex);
+	if (!config)
+		goto exit;
+
+	e = image_lookup(config, prefix, prefix_len, key, key_len, hash);
+	if (!e)
+		goto exit;
+
+	switch (type) {
+	default:
+		goto exit;
+
+	case TYPE_STRING:
+		if (out_size < (int)e->str_len + 1)
+			goto exit;
+
+		memcpy(out_value, image_strings(config) + e->str,
+		       e->str_len + 1);
+		break;
+
+	case TYPE_ARRAY_INT:
+		/* out_size is the number of ints for arrays */
+		if (e->array_len > out_size)
+			goto exit;
+
+		memcpy(out_value, image_ints(config) + e->array,
+		       e->array_len * sizeof(int32_t));
+		break;
+
+	case TYPE_INT:
+		if (out_size < (int)sizeof(int))
+			goto exit;
+
+		*((int*)out_value) = e->value;
+		break;
 	}
-	return -1;
+	rc = 0;
+exit:
+	pthread_mutex_unlock(&config_mutex);
+	return rc;
 }
 
 void sensors_config_destroy()
 {
-	struct config_entry_t *p = config_list;
-	struct config_entry_t *p_next;
-
-	while (p) {
-		p_next = p->next;
-		free(p);
-		p = p_next;
-	}
+	swap_image(NULL, 0, NULL);
 }
-
@@ -29,4 +29,28 @@ int sensors_config_get_key(char* prefix, char* key, enum config_type_t type,
 			   void *out_value, int out_size);
 void sensors_config_destroy();
 
+/*
+ * Live reload. sensors_config_reload() re-reads the file last loaded by
+ * sensors_config_read(), swaps it in and calls all registered notifiers.
+ * It is triggered by the watcher, see sensors_config_watch(), from a select
+ * thread holding wrapper_mutex, i.e. between two samples of any driver.
+ */
+struct sensors_config_notifier {
+	void (*reload)(struct sensors_config_notifier *n);
+	struct sensors_config_notifier *next;
+};
+
+void sensors_config_register_notifier(struct sensors_config_notifier *n);
+int sensors_config_reload();
+int sensors_config_path(char *out, int out_size);
+int sensors_config_watch();
+void sensors_config_unwatch();
+
+/*
+ * Compile a text config into the binary image loaded from <config>.bin.
+ * The image is mapped by every process loading the HAL, so it is written
+ * to <out_filename>.tmp and renamed into place; replace it no other way.
+ */
+int sensors_config_compile(char* filename, char* out_filename);
+
 #endif
@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "sensors_config.h"
+
+/*
+ * Host tool turning a text config into the binary image the HAL maps
+ * from <config>.bin, e.g.:
+ *   dash_config_compiler dash.conf dash.conf.bin
+ */
+int main(int argc, char *argv[])
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <config> <output>\n", argv[0]);
+		return 1;
+	}
+
+	if (sensors_config_compile(argv[1], argv[2]) < 0) {
+		fprintf(stderr, "%s: failed to compile %s\n", argv[0], argv[1]);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DASH - config watch"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include "sensors_log.h"
+#include "sensors_config.h"
+#include "sensors_select.h"
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+#define BINARY_SUFFIX ".bin"
+
+static struct sensors_select_t watcher;
+static int watching;
+static char watch_name[NAME_MAX + 1];
+
+static int config_file_changed(const struct inotify_event *e)
+{
+	size_t l = strlen(watch_name);
+
+	if (!e->len || !(e->mask & WATCH_MASK))
+		return 0;
+	if (strncmp(e->name, watch_name, l))
+		return 0;
+
+	return !e->name[l] || !strcmp(e->name + l, BINARY_SUFFIX);
+}
+
+/* called by the select thread with wrapper_mutex held */
+static void *config_watch_read(void *arg)
+{
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	int fd = watcher.get_fd(&watcher);
+	int changed = 0;
+	ssize_t n;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		char *p = buf;
+
+		while (p < buf + n) {
+			struct inotify_event *e = (struct inotify_event *)p;
+
+			changed |= config_file_changed(e);
+			p += sizeof(*e) + e->len;
+		}
+	}
+
+	if (changed)
+		sensors_config_reload();
+
+	return NULL;
+}
+
+int sensors_config_watch()
+{
+	char path[PATH_MAX];
+	const char *dir;
+	char *name;
+	int fd;
+
+	if (watching)
+		return 0;
+
+	if (sensors_config_path(path, sizeof(path)) < 0)
+		return -1;
+
+	name = strrchr(path, '/');
+	if (name) {
+		*name++ = 0;
+		dir = *path ? path : "/";
+	} else {
+		name = path;
+		dir = ".";
+	}
+	if (snprintf(watch_name, sizeof(watch_name), "%s", name) >=
+	    (int)sizeof(watch_name)) {
+		ALOGE("%s: config name too long: %s", __func__, name);
+		return -1;
+	}
+
+	fd = inotify_init();
+	if (fd < 0) {
+		ALOGE("%s: inotify_init failed: %s", __func__, strerror(errno));
+		return -1;
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+
+	if (inotify_add_watch(fd, dir, WATCH_MASK) < 0) {
+		ALOGE("%s: unable to watch %s: %s", __func__, dir,
+		      strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	sensors_select_init(&watcher, config_watch_read, NULL, fd);
+	watcher.resume(&watcher);
+	watching = 1;
+
+	return 0;
+}
+
+void sensors_config_unwatch()
+{
+	if (!watching)
+		return;
+
+	/* wake the select thread so destroy does not wait for an event */
+	watcher.suspend(&watcher);
+	watcher.destroy(&watcher);
+	watching = 0;
+}
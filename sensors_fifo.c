@@ -19,6 +19,10 @@
 #include "sensors_log.h"
 #include <pthread.h>
 #include "sensors_fifo.h"
+#include "sensors_stats.h"
+#include "sensors_trace.h"
+#include "sensors_lockprof.h"
+#include "sensor_util.h"
 
 #define FIFO_LEN 8
 
@@ -41,29 +45,83 @@ void sensors_fifo_deinit()
 	pthread_mutex_destroy(&sensors_fifo.mutex);
 }
 
+/* account n events of a put, the first queued of which were queued */
+static void fifo_put_stats(sensors_event_t *data, int n, int queued)
+{
+	int64_t now = get_current_nano_time();
+	int i;
+
+	for (i = 0; i < n; i++) {
+		sensors_stats_produced(data[i].sensor, 1);
+		if (i < queued)
+			sensors_stats_latency(data[i].sensor, STATS_PUT,
+					      now - data[i].timestamp);
+		else
+			sensors_stats_dropped(data[i].sensor, 1);
+	}
+}
+
 void sensors_fifo_put(sensors_event_t *data)
 {
-	pthread_mutex_lock(&sensors_fifo.mutex);
+	int queued = 0;
+	int depth;
 
-	if (sensors_fifo.fifo_i < FIFO_LEN)
+	PROF_LOCK(&sensors_fifo.mutex, "fifo");
+
+	if (sensors_fifo.fifo_i < FIFO_LEN) {
 		sensors_fifo.fifo[sensors_fifo.fifo_i++] = *data;
+		queued = 1;
+	}
+	depth = sensors_fifo.fifo_i;
 
 	pthread_cond_broadcast(&sensors_fifo.data_cond);
-	pthread_mutex_unlock(&sensors_fifo.mutex);
+	PROF_UNLOCK(&sensors_fifo.mutex);
+
+	TRACE_INT("fifo_depth", depth);
+	fifo_put_stats(data, 1, queued);
 }
 
-int sensors_fifo_get_all(sensors_event_t *data, int len)
+/* queue n events under a single lock and wake the reader once */
+void sensors_fifo_put_batch(sensors_event_t *data, int n)
 {
+	int depth;
 	int i;
 
+	PROF_LOCK(&sensors_fifo.mutex, "fifo");
+
+	for (i = 0; i < n && sensors_fifo.fifo_i < FIFO_LEN; i++)
+		sensors_fifo.fifo[sensors_fifo.fifo_i++] = data[i];
+	depth = sensors_fifo.fifo_i;
+
+	pthread_cond_broadcast(&sensors_fifo.data_cond);
+	PROF_UNLOCK(&sensors_fifo.mutex);
+
+	TRACE_INT("fifo_depth", depth);
+	fifo_put_stats(data, n, i);
+}
+
+int sensors_fifo_get_all(sensors_event_t *data, int len)
+{
+	int64_t now;
+	int i, n;
+
 	/* This function deliberately drops all packets above len. */
-	pthread_mutex_lock(&sensors_fifo.mutex);
-	pthread_cond_wait(&sensors_fifo.data_cond, &sensors_fifo.mutex);
+	PROF_LOCK(&sensors_fifo.mutex, "fifo");
+	PROF_COND_WAIT(&sensors_fifo.data_cond, &sensors_fifo.mutex);
 
 	for (i = 0; (i < sensors_fifo.fifo_i) && (i < len); i++)
 		data[i] = sensors_fifo.fifo[i];
+	for (n = i; n < sensors_fifo.fifo_i; n++)
+		sensors_stats_dropped(sensors_fifo.fifo[n].sensor, 1);
 	sensors_fifo.fifo_i = 0;
-	pthread_mutex_unlock(&sensors_fifo.mutex);
+	PROF_UNLOCK(&sensors_fifo.mutex);
+
+	now = get_current_nano_time();
+	for (n = 0; n < i; n++) {
+		sensors_stats_delivered(data[n].sensor, 1);
+		sensors_stats_latency(data[n].sensor, STATS_POLL,
+				      now - data[n].timestamp);
+	}
 
 	return i;
 }
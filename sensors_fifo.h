@@ -21,6 +21,7 @@
 void sensors_fifo_init();
 void sensors_fifo_deinit();
 void sensors_fifo_put(sensors_event_t *data);
+void sensors_fifo_put_batch(sensors_event_t *data, int n);
 int sensors_fifo_get_all(sensors_event_t *data, int len);
 
 #endif
@@ -37,6 +37,10 @@
 #define SENSOR_GAME_ROTATION_VECTOR_HANDLE         15
 #define SENSOR_GYROSCOPE_UNCALIBRATED_HANDLE       16
 #define SENSOR_GEOMAGNETIC_ROTATION_VECTOR_HANDLE  20
+/* debug handle, activating it dumps the HAL statistics. It is not in the
+   sensor list, so only tests use it; on a device create
+   SENSORS_STATS_REQUEST instead */
+#define SENSOR_STATS_HANDLE                 99
 /* range for sensors not exposed to android */
 #define SENSOR_INTERNAL_HANDLE_MIN         100
 #define SENSOR_INTERNAL_HANDLE_MAX         110
@@ -17,6 +17,7 @@
 #define LOG_TAG "DASH - input_cache"
 
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <dirent.h>
@@ -24,11 +25,14 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
 #include <linux/input.h>
 #include "sensors_log.h"
 #include "sensor_util.h"
 #include "sensor_util_list.h"
 #include "sensors_input_cache.h"
+#include "sensors_root.h"
 
 #define MAX_EVENT_DRIVERS 100
 
@@ -44,11 +48,35 @@ static int list_initialized;
 
 static void *close_input_dev_fd(void *arg)
 {
-	close((int) arg); /* pass by copy */
+	close((int)(intptr_t) arg); /* pass by copy */
 
 	return NULL;
 }
 
+/* a device without the evdev ioctls, e.g. a pipe standing in for one on a
+   host, is named by sysfs the way the input core names it */
+static int sysfs_dev_name(const char *event, char *name, int len)
+{
+	char path[PATH_MAX];
+	int fd;
+	int n;
+
+	snprintf(path, sizeof(path), "%s/sys/class/input/%s/device/name",
+		 sensors_root(), event);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	n = read(fd, name, len - 1);
+	close(fd);
+	if (n < 0)
+		return -1;
+	while (n > 0 && name[n - 1] == '\n')
+		n--;
+	name[n] = 0;
+
+	return 0;
+}
+
 static struct input_dev_list *lookup(const char *name, const char *path)
 {
 	struct list_node *member;
@@ -74,8 +102,8 @@ const struct sensors_input_cache_entry_t *sensors_input_cache_get(
 	int fd;
 	DIR *dir;
 	struct dirent * item;
-	struct list_node *member;
 	struct input_dev_list *temp;
+	char dir_path[PATH_MAX];
 	pthread_t id[MAX_EVENT_DRIVERS];
 	unsigned int i = 0;
 	unsigned int threads = 0;
@@ -93,10 +121,11 @@ const struct sensors_input_cache_entry_t *sensors_input_cache_get(
 		goto exit;
 	}
 
-	dir = opendir(INPUT_EVENT_DIR);
+	snprintf(dir_path, sizeof(dir_path), "%s%s", sensors_root(),
+		 INPUT_EVENT_DIR);
+	dir = opendir(dir_path);
 	if (!dir) {
-		ALOGE("%s: error opening '%s'\n", __func__,
-				INPUT_EVENT_DIR);
+		ALOGE("%s: error opening '%s'\n", __func__, dir_path);
 		goto exit;
 	}
 
@@ -113,8 +142,14 @@ const struct sensors_input_cache_entry_t *sensors_input_cache_get(
 		}
 
 		/* skip already cached entries */
-		snprintf(temp->entry.event_path, sizeof(temp->entry.event_path),
-			 "%s%s", INPUT_EVENT_DIR, item->d_name);
+		rc = snprintf(temp->entry.event_path,
+			      sizeof(temp->entry.event_path), "%s%s",
+			      dir_path, item->d_name);
+		if (rc >= (int)sizeof(temp->entry.event_path)) {
+			ALOGE("%s: path too long for %s", __func__,
+			      item->d_name);
+			continue;
+		}
 		if (lookup(NULL, temp->entry.event_path))
 			continue;
 
@@ -128,10 +163,13 @@ const struct sensors_input_cache_entry_t *sensors_input_cache_get(
 
 		rc = ioctl(fd, EVIOCGNAME(sizeof(temp->entry.dev_name)),
 				temp->entry.dev_name);
+		if (rc < 0 && errno == ENOTTY)
+			rc = sysfs_dev_name(item->d_name, temp->entry.dev_name,
+					    sizeof(temp->entry.dev_name));
 
 		/* close in parallell to optimize boot time */
 		pthread_create(&id[threads++], NULL,
-				close_input_dev_fd, (void*) fd);
+				close_input_dev_fd, (void*)(intptr_t) fd);
 
 		if (rc < 0) {
 			ALOGE("%s: cant get name from  %s", __func__,
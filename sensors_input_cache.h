@@ -16,6 +16,7 @@
 
 #ifndef SENSORS_INPUT_CACHE_H_
 #define SENSORS_INPUT_CACHE_H_
+#include <limits.h>
 
 #define INPUT_EVENT_DIR      "/dev/input/"
 #define INPUT_EVENT_BASENAME "event"
@@ -25,7 +26,7 @@
 struct sensors_input_cache_entry_t {
 	int nr;
 	char dev_name[32];
-	char event_path[sizeof(INPUT_EVENT_PATH) + MAX_INT_STRING_SIZE];
+	char event_path[PATH_MAX];
 };
 
 const struct sensors_input_cache_entry_t *sensors_input_cache_get(
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DASH - lockprof"
+
+#include "sensors_lockprof.h"
+
+#ifdef SENSORS_LOCK_PROF
+
+#include <string.h>
+#include <time.h>
+#include "sensors_log.h"
+
+#define MAX_SITES 64
+#define MAX_LOCKS 32
+
+#define ADD(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define GET(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+enum { SLOT_FREE, SLOT_CLAIMED, SLOT_READY };
+
+/* one call site of one lock, counters are only ever added to */
+struct lock_site {
+	int state;
+	const char *name;
+	const char *file;
+	int line;
+	uint64_t acquired;
+	uint64_t contended;
+	uint64_t wait_ns;
+	uint64_t wait_max;
+	uint64_t hold_ns;
+	uint64_t hold_max;
+};
+
+/* the current holder of a lock, only touched while the lock is held */
+struct lock_held {
+	const void *lock;
+	struct lock_site *site;
+	int64_t since;
+};
+
+static struct lock_site sites[MAX_SITES];
+static struct lock_held held[MAX_LOCKS];
+
+int64_t sensors_lockprof_now()
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static void set_max(uint64_t *p, uint64_t v)
+{
+	uint64_t max = GET(p);
+
+	while (v > max && !__atomic_compare_exchange_n(p, &max, v, 1,
+			__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/* open addressing on the call site, a free slot is claimed with a CAS */
+static struct lock_site *find_site(const char *name, const char *file,
+				   int line)
+{
+	unsigned int h = ((uintptr_t)file >> 3) * 31 + line;
+	struct lock_site *s;
+	int expected;
+	int i;
+
+	for (i = 0; i < MAX_SITES; i++) {
+		s = &sites[(h + i) % MAX_SITES];
+		expected = SLOT_FREE;
+		if (__atomic_compare_exchange_n(&s->state, &expected,
+				SLOT_CLAIMED, 0, __ATOMIC_ACQUIRE,
+				__ATOMIC_ACQUIRE)) {
+			s->name = name;
+			s->file = file;
+			s->line = line;
+			__atomic_store_n(&s->state, SLOT_READY,
+					 __ATOMIC_RELEASE);
+			return s;
+		}
+		while (expected == SLOT_CLAIMED)
+			expected = __atomic_load_n(&s->state,
+						   __ATOMIC_ACQUIRE);
+		if (s->file == file && s->line == line && s->name == name)
+			return s;
+	}
+
+	return NULL;
+}
+
+static struct lock_held *find_held(const void *lock)
+{
+	unsigned int h = (uintptr_t)lock >> 3;
+	struct lock_held *l;
+	const void *expected;
+	int i;
+
+	for (i = 0; i < MAX_LOCKS; i++) {
+		l = &held[(h + i) % MAX_LOCKS];
+		expected = NULL;
+		if (__atomic_compare_exchange_n(&l->lock, &expected, lock, 0,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED) ||
+		    expected == lock)
+			return l;
+	}
+
+	return NULL;
+}
+
+void sensors_lockprof_acquired(const void *lock, const char *name,
+			       const char *file, int line,
+			       int64_t t_req, int contended)
+{
+	struct lock_site *s = find_site(name, file, line);
+	struct lock_held *l = find_held(lock);
+	int64_t now = sensors_lockprof_now();
+
+	/* sites beyond MAX_SITES are not profiled */
+	if (!s)
+		return;
+
+	ADD(&s->acquired, 1);
+	if (contended) {
+		ADD(&s->contended, 1);
+		ADD(&s->wait_ns, now - t_req);
+		set_max(&s->wait_max, now - t_req);
+	}
+
+	if (l) {
+		l->site = s;
+		l->since = now;
+	}
+}
+
+void sensors_lockprof_released(const void *lock)
+{
+	struct lock_held *l = find_held(lock);
+	int64_t hold;
+
+	if (!l || !l->site || !l->since)
+		return;
+
+	hold = sensors_lockprof_now() - l->since;
+	ADD(&l->site->hold_ns, hold);
+	set_max(&l->site->hold_max, hold);
+	l->since = 0;
+}
+
+void sensors_lockprof_lock(pthread_mutex_t *m, const char *name,
+			   const char *file, int line)
+{
+	int64_t t = sensors_lockprof_now();
+	int contended = 0;
+
+	if (pthread_mutex_trylock(m)) {
+		contended = 1;
+		pthread_mutex_lock(m);
+	}
+	sensors_lockprof_acquired(m, name, file, line, t, contended);
+}
+
+void sensors_lockprof_unlock(pthread_mutex_t *m)
+{
+	sensors_lockprof_released(m);
+	pthread_mutex_unlock(m);
+}
+
+/* the time spent waiting for the condition does not count as held */
+void sensors_lockprof_cond_wait(pthread_cond_t *c, pthread_mutex_t *m)
+{
+	struct lock_held *l;
+
+	sensors_lockprof_released(m);
+	pthread_cond_wait(c, m);
+	l = find_held(m);
+	if (l)
+		l->since = sensors_lockprof_now();
+}
+
+static void dump_line(FILE *f, const char *what, uint64_t acq,
+		      uint64_t cont, uint64_t wait, uint64_t wait_max,
+		      uint64_t hold, uint64_t hold_max)
+{
+	fprintf(f, "%s %llu %llu %llu %llu %llu %llu\n", what,
+		(unsigned long long)acq, (unsigned long long)cont,
+		(unsigned long long)wait / 1000,
+		(unsigned long long)wait_max / 1000,
+		(unsigned long long)hold / 1000,
+		(unsigned long long)hold_max / 1000);
+}
+
+void sensors_lockprof_dump(FILE *f)
+{
+	char what[128];
+	struct lock_site *s, *t;
+	uint64_t v[6];
+	int i, j;
+
+	fprintf(f, "# lock [site] acquired contended wait_us wait_max_us "
+		"hold_us hold_max_us\n");
+
+	for (i = 0; i < MAX_SITES; i++) {
+		s = &sites[i];
+		if (GET(&s->state) != SLOT_READY)
+			continue;
+
+		/* the lock summary is printed before its first site */
+		for (j = 0; j < i; j++) {
+			t = &sites[j];
+			if (GET(&t->state) == SLOT_READY &&
+			    !strcmp(t->name, s->name))
+				break;
+		}
+		if (j < i)
+			continue;
+
+		memset(v, 0, sizeof(v));
+		for (j = i; j < MAX_SITES; j++) {
+			t = &sites[j];
+			if (GET(&t->state) != SLOT_READY ||
+			    strcmp(t->name, s->name))
+				continue;
+			v[0] += GET(&t->acquired);
+			v[1] += GET(&t->contended);
+			v[2] += GET(&t->wait_ns);
+			v[3] = GET(&t->wait_max) > v[3] ?
+				GET(&t->wait_max) : v[3];
+			v[4] += GET(&t->hold_ns);
+			v[5] = GET(&t->hold_max) > v[5] ?
+				GET(&t->hold_max) : v[5];
+		}
+		dump_line(f, s->name, v[0], v[1], v[2], v[3], v[4], v[5]);
+
+		for (j = i; j < MAX_SITES; j++) {
+			t = &sites[j];
+			if (GET(&t->state) != SLOT_READY ||
+			    strcmp(t->name, s->name))
+				continue;
+			snprintf(what, sizeof(what), "  %s:%d", t->file,
+				 t->line);
+			dump_line(f, what, GET(&t->acquired),
+				  GET(&t->contended), GET(&t->wait_ns),
+				  GET(&t->wait_max), GET(&t->hold_ns),
+				  GET(&t->hold_max));
+		}
+	}
+}
+
+#endif
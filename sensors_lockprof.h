@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSORS_LOCKPROF_H_
+#define SENSORS_LOCKPROF_H_
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Lock contention profiler. Built with -DSENSORS_LOCK_PROF every
+ * PROF_LOCK records, per lock name and per call site, the number of
+ * acquisitions, how many of them had to wait, the wait time and the
+ * time the lock was then held. Otherwise the macros are plain pthread
+ * calls.
+ */
+#ifdef SENSORS_LOCK_PROF
+int64_t sensors_lockprof_now();
+void sensors_lockprof_acquired(const void *lock, const char *name,
+			       const char *file, int line,
+			       int64_t t_req, int contended);
+void sensors_lockprof_released(const void *lock);
+void sensors_lockprof_lock(pthread_mutex_t *m, const char *name,
+			   const char *file, int line);
+void sensors_lockprof_unlock(pthread_mutex_t *m);
+void sensors_lockprof_cond_wait(pthread_cond_t *c, pthread_mutex_t *m);
+void sensors_lockprof_dump(FILE *f);
+
+#define PROF_LOCK(m, name) \
+	sensors_lockprof_lock(m, name, __FILE__, __LINE__)
+#define PROF_UNLOCK(m)		sensors_lockprof_unlock(m)
+#define PROF_COND_WAIT(c, m)	sensors_lockprof_cond_wait(c, m)
+#else
+#define PROF_LOCK(m, name)	pthread_mutex_lock(m)
+#define PROF_UNLOCK(m)		pthread_mutex_unlock(m)
+#define PROF_COND_WAIT(c, m)	pthread_cond_wait(c, m)
+#endif
+
+#endif
@@ -20,9 +20,33 @@
 #include "sensors_log.h"
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "sensors_list.h"
 #include "sensors_config.h"
 #include "sensors_fifo.h"
+#include "sensors_id.h"
+#include "sensors_stats.h"
+#include "sensors_trace.h"
+#include "sensors_root.h"
+
+static int sensors_module_dump_stats()
+{
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s" SENSORS_STATS_FILE, sensors_root());
+	return sensors_stats_dump_file(path);
+}
+
+static int sensors_module_watch_stats()
+{
+	char path[PATH_MAX];
+	char request[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s" SENSORS_STATS_FILE, sensors_root());
+	snprintf(request, sizeof(request), "%s" SENSORS_STATS_REQUEST,
+		 sensors_root());
+	return sensors_stats_watch(path, request);
+}
 
 static int sensors_module_set_delay(struct sensors_poll_device_t *dev,
 				    int handle, int64_t ns)
@@ -43,8 +67,12 @@ static int sensors_module_set_delay(struct sensors_poll_device_t *dev,
 static int sensors_module_activate(struct sensors_poll_device_t *dev,
 				   int handle, int enabled)
 {
-	struct sensor_api_t* api = sensors_list_get_api_from_handle(handle);
+	struct sensor_api_t* api;
+
+	if (handle == SENSOR_STATS_HANDLE)
+		return enabled ? sensors_module_dump_stats() : 0;
 
+	api = sensors_list_get_api_from_handle(handle);
 	if (!api) {
 		ALOGE("%s: unable to find handle!", __func__);
                 return -1;
@@ -64,11 +92,15 @@ static int sensors_module_poll(struct sensors_poll_device_t *dev,
 	while ((ret = sensors_fifo_get_all(data, count)) == 0)
 		;
 
+	TRACE_INT("poll_return", ret);
 	return ret;
 }
 
 static int sensors_module_close(struct hw_device_t* device)
 {
+	sensors_config_unwatch();
+	sensors_stats_unwatch();
+	sensors_module_dump_stats();
 	sensors_fifo_deinit();
 	sensors_config_destroy();
 	free(device);
@@ -105,6 +137,8 @@ static int sensors_module_open(const struct hw_module_t* module, const char* id,
 	sensors_config_read(NULL);
 	sensors_fifo_init();
 	sensors_list_foreach_api(sensors_init_iterator, NULL);
+	sensors_config_watch();
+	sensors_module_watch_stats();
 
 	return 0;
 }
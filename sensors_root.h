@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSORS_ROOT_H_
+#define SENSORS_ROOT_H_
+
+/*
+ * Prefix of the /dev, /sys, /etc and /data paths the HAL looks up. A host
+ * build (-DSENSORS_HOST) takes it from $DASH_ROOT so the HAL can run
+ * against a fake device tree, on target it is always empty.
+ */
+#ifdef SENSORS_HOST
+#include <stdlib.h>
+
+/* room fixed size path buffers keep for the prefix */
+#define SENSORS_ROOT_MAX 256
+
+static inline const char *sensors_root()
+{
+	const char *root = getenv("DASH_ROOT");
+
+	return root ? root : "";
+}
+#else
+#define SENSORS_ROOT_MAX 0
+
+static inline const char *sensors_root()
+{
+	return "";
+}
+#endif
+
+#endif
@@ -26,17 +26,19 @@
 #include <fcntl.h>
 #include <errno.h>
 #include "sensors_select.h"
+#include "sensors_trace.h"
+#include "sensors_lockprof.h"
 
 extern pthread_mutex_t wrapper_mutex;
 
 #define LOCK(p) do { \
 	ALOGV_IF(DEBUG_VERBOSE, "%s(%d): %s: lock\n", __FILE__, __LINE__, __func__); \
-	pthread_mutex_lock(p); \
+	PROF_LOCK(p, #p); \
 } while (0)
 
 #define UNLOCK(p) do { \
 	ALOGV_IF(DEBUG_VERBOSE, "%s(%d): %s: unlock\n", __FILE__, __LINE__, __func__); \
-	pthread_mutex_unlock(p); \
+	PROF_UNLOCK(p); \
 } while (0)
 
 static void *sensors_select_callback(void *arg)
@@ -63,12 +65,14 @@ static void *sensors_select_callback(void *arg)
 		if (FD_ISSET(s->ctl_fds[0], &readfds)) {
 			read(s->ctl_fds[0], &ret, sizeof(ret));
 		} else if (fd >= 0 && FD_ISSET(fd, &readfds)) {
+			TRACE_BEGIN("select_wakeup");
 			LOCK(&wrapper_mutex);
 			LOCK(&s->fd_mutex);
 			if (s->fd == fd)
 			    s->select_callback(s->arg);
 			UNLOCK(&s->fd_mutex);
 			UNLOCK(&wrapper_mutex);
+			TRACE_END();
 		}
 	}
 	return NULL;
@@ -76,7 +80,8 @@ static void *sensors_select_callback(void *arg)
 
 static void scheduler_select_notify(struct sensors_select_t* s)
 {
-	int rc = write(s->ctl_fds[1], &rc, sizeof (rc));
+	int val = 0;
+	int rc = write(s->ctl_fds[1], &val, sizeof (val));
 	if (rc < 0)
 		ALOGE("%s: write failed: %s", __func__, strerror(errno));
 }
@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DASH - stats"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/inotify.h>
+#include "sensors_log.h"
+#include "sensors_id.h"
+#include "sensors_select.h"
+#include "sensors_stats.h"
+#include "sensors_lockprof.h"
+
+/* android handles first, then the internal range, then everything else */
+#define ANDROID_SLOTS 32
+#define INTERNAL_SLOTS \
+	(SENSOR_INTERNAL_HANDLE_MAX - SENSOR_INTERNAL_HANDLE_MIN + 1)
+#define OTHER_SLOT (ANDROID_SLOTS + INTERNAL_SLOTS)
+#define STATS_SLOTS (OTHER_SLOT + 1)
+
+/* bucket b holds latencies in [2^b, 2^(b+1)) us, bucket 0 everything
+   below 2 us and the last one everything above */
+#define STATS_BUCKETS 20
+
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+#define INC(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define GET(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+
+/*
+ * Writers only ever add with relaxed atomics, so the hot path takes no
+ * lock and the dump may see one counter a few events ahead of another.
+ */
+struct stats_slot {
+	uint32_t produced;
+	uint32_t delivered;
+	uint32_t dropped;
+	uint32_t coalesced;
+	uint32_t hist[STATS_STAGES][STATS_BUCKETS];
+	uint64_t max_ns[STATS_STAGES];
+};
+
+static struct stats_slot stats[STATS_SLOTS];
+
+static struct sensors_select_t watcher;
+static int watching;
+static char dump_path[PATH_MAX];
+static char request_path[PATH_MAX];
+static const char *request_name;
+
+static const char *stage_name[STATS_STAGES] = {
+	[STATS_READ] = "read",
+	[STATS_PUT] = "put",
+	[STATS_POLL] = "poll",
+};
+
+static struct stats_slot *slot(int handle)
+{
+	if (handle >= 0 && handle < ANDROID_SLOTS)
+		return &stats[handle];
+	if (handle >= SENSOR_INTERNAL_HANDLE_MIN &&
+	    handle <= SENSOR_INTERNAL_HANDLE_MAX)
+		return &stats[ANDROID_SLOTS + handle -
+			      SENSOR_INTERNAL_HANDLE_MIN];
+	return &stats[OTHER_SLOT];
+}
+
+static int slot_handle(int i)
+{
+	if (i < ANDROID_SLOTS)
+		return i;
+	if (i < OTHER_SLOT)
+		return i - ANDROID_SLOTS + SENSOR_INTERNAL_HANDLE_MIN;
+	return -1;
+}
+
+static int bucket(int64_t ns)
+{
+	uint64_t us = ns > 0 ? (uint64_t)ns / 1000 : 0;
+	int b;
+
+	if (us < 2)
+		return 0;
+	b = 63 - __builtin_clzll(us);
+	return b < STATS_BUCKETS ? b : STATS_BUCKETS - 1;
+}
+
+void sensors_stats_produced(int handle, int n)
+{
+	INC(&slot(handle)->produced, n);
+}
+
+void sensors_stats_delivered(int handle, int n)
+{
+	INC(&slot(handle)->delivered, n);
+}
+
+void sensors_stats_dropped(int handle, int n)
+{
+	INC(&slot(handle)->dropped, n);
+}
+
+void sensors_stats_coalesced(int handle, int n)
+{
+	INC(&slot(handle)->coalesced, n);
+}
+
+void sensors_stats_latency(int handle, enum sensors_stats_stage stage,
+			   int64_t ns)
+{
+	struct stats_slot *s = slot(handle);
+	uint64_t max;
+
+	INC(&s->hist[stage][bucket(ns)], 1);
+
+	if (ns <= 0)
+		return;
+	max = GET(&s->max_ns[stage]);
+	while ((uint64_t)ns > max &&
+	       !__atomic_compare_exchange_n(&s->max_ns[stage], &max, ns, 1,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+static int slot_used(const struct stats_slot *s)
+{
+	return GET(&s->produced) || GET(&s->delivered) ||
+		GET(&s->dropped) || GET(&s->coalesced);
+}
+
+int sensors_stats_dump(int fd)
+{
+	FILE *f;
+	int i, j, k;
+	int fd2 = dup(fd);
+
+	if (fd2 < 0)
+		return -errno;
+	f = fdopen(fd2, "w");
+	if (!f) {
+		close(fd2);
+		return -errno;
+	}
+
+	fprintf(f, "# handle produced delivered dropped coalesced\n");
+	fprintf(f, "# stage max_us hist (bucket b counts [2^b, 2^(b+1)) us)\n");
+
+	for (i = 0; i < STATS_SLOTS; i++) {
+		struct stats_slot *s = &stats[i];
+
+		if (!slot_used(s))
+			continue;
+
+		fprintf(f, "%d %u %u %u %u\n", slot_handle(i),
+			GET(&s->produced), GET(&s->delivered),
+			GET(&s->dropped), GET(&s->coalesced));
+
+		for (j = 0; j < STATS_STAGES; j++) {
+			fprintf(f, "  %-4s %llu", stage_name[j],
+				(unsigned long long)GET(&s->max_ns[j]) / 1000);
+			for (k = 0; k < STATS_BUCKETS; k++)
+				fprintf(f, " %u", GET(&s->hist[j][k]));
+			fprintf(f, "\n");
+		}
+	}
+
+#ifdef SENSORS_LOCK_PROF
+	sensors_lockprof_dump(f);
+#endif
+
+	return fclose(f) ? -errno : 0;
+}
+
+int sensors_stats_dump_file(const char *path)
+{
+	char tmp[PATH_MAX];
+	int fd;
+	int rc;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0640);
+	if (fd < 0) {
+		rc = -errno;
+		ALOGE("%s: unable to open %s: %s", __func__, tmp,
+			strerror(errno));
+		return rc;
+	}
+
+	rc = sensors_stats_dump(fd);
+	close(fd);
+
+	if (!rc && rename(tmp, path) < 0)
+		rc = -errno;
+	if (rc)
+		ALOGE("%s: unable to write %s: %s", __func__, path,
+			strerror(-rc));
+	return rc;
+}
+
+static void *stats_watch_read(void *arg)
+{
+	char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	int fd = watcher.get_fd(&watcher);
+	int requested = 0;
+	ssize_t n;
+
+	while ((n = read(fd, buf, sizeof(buf))) > 0) {
+		char *p = buf;
+
+		while (p < buf + n) {
+			struct inotify_event *e = (struct inotify_event *)p;
+
+			if (e->len && (e->mask & WATCH_MASK) &&
+			    !strcmp(e->name, request_name))
+				requested = 1;
+			p += sizeof(*e) + e->len;
+		}
+	}
+
+	/* removed so the next request creates it again */
+	if (requested) {
+		unlink(request_path);
+		sensors_stats_dump_file(dump_path);
+	}
+
+	return NULL;
+}
+
+int sensors_stats_watch(const char *path, const char *request)
+{
+	char dir[PATH_MAX];
+	char *name;
+	int fd;
+
+	if (watching)
+		return 0;
+
+	snprintf(dump_path, sizeof(dump_path), "%s", path);
+	snprintf(request_path, sizeof(request_path), "%s", request);
+	snprintf(dir, sizeof(dir), "%s", request);
+	name = strrchr(dir, '/');
+	if (!name) {
+		ALOGE("%s: %s is not an absolute path", __func__, request);
+		return -1;
+	}
+	*name = 0;
+	request_name = request_path + (name - dir) + 1;
+
+	fd = inotify_init();
+	if (fd < 0) {
+		ALOGE("%s: inotify_init failed: %s", __func__, strerror(errno));
+		return -1;
+	}
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+
+	if (inotify_add_watch(fd, *dir ? dir : "/", WATCH_MASK) < 0) {
+		ALOGE("%s: unable to watch %s: %s", __func__, dir,
+		      strerror(errno));
+		close(fd);
+		return -1;
+	}
+
+	sensors_select_init(&watcher, stats_watch_read, NULL, fd);
+	watcher.resume(&watcher);
+	watching = 1;
+
+	return 0;
+}
+
+void sensors_stats_unwatch(void)
+{
+	if (!watching)
+		return;
+
+	watcher.suspend(&watcher);
+	watcher.destroy(&watcher);
+	watching = 0;
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSORS_STATS_H_
+#define SENSORS_STATS_H_
+#include <stdint.h>
+
+#ifndef SENSORS_STATS_FILE
+#define SENSORS_STATS_FILE "/data/misc/sensors/dash_stats.txt"
+#endif
+
+/* creating this file dumps the statistics, e.g. with touch over adb */
+#ifndef SENSORS_STATS_REQUEST
+#define SENSORS_STATS_REQUEST "/data/misc/sensors/dash_stats.req"
+#endif
+
+/* latency of an event from its timestamp to each stage of the HAL */
+enum sensors_stats_stage {
+	STATS_READ,	/* read from the driver */
+	STATS_PUT,	/* queued in the fifo */
+	STATS_POLL,	/* returned from poll */
+	STATS_STAGES,
+};
+
+void sensors_stats_produced(int handle, int n);
+void sensors_stats_delivered(int handle, int n);
+void sensors_stats_dropped(int handle, int n);
+void sensors_stats_coalesced(int handle, int n);
+void sensors_stats_latency(int handle, enum sensors_stats_stage stage,
+			   int64_t ns);
+int sensors_stats_dump(int fd);
+int sensors_stats_dump_file(const char *path);
+int sensors_stats_watch(const char *path, const char *request);
+void sensors_stats_unwatch(void);
+
+#endif
@@ -17,11 +17,15 @@
 #define LOG_TAG "DASH - sysfs"
 
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include "sensors_log.h"
 #include "sensors_input_cache.h"
 #include "sensors_sysfs.h"
+#include "sensors_root.h"
 
 static const char *input_class_path = "/sys/class/input/input";
 
@@ -79,8 +83,8 @@ int sensors_sysfs_init(struct sensors_sysfs_t* s, const char *str,
 			ALOGE("sensors_input_cache_get failed!\n");
 			return -1;
 		}
-		count = snprintf(s->data.path, sizeof(s->data.path), "%s%d",
-				 input_class_path, input->nr);
+		count = snprintf(s->data.path, sizeof(s->data.path), "%s%s%d",
+				 sensors_root(), input_class_path, input->nr);
 		if ((count < 0) || (count >= (int)sizeof(s->data.path))) {
 			ALOGE("%s: snprintf failed!\n", __func__);
 			return -1;
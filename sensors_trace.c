@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DASH - trace"
+
+#include "sensors_trace.h"
+
+#ifdef SENSORS_TRACE
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include "sensors_log.h"
+
+#define TRACE_LEN 64
+
+static const char *marker_paths[] = {
+	"/sys/kernel/debug/tracing/trace_marker",
+	"/sys/kernel/tracing/trace_marker",
+};
+
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static int trace_fd = -1;
+static int trace_pid;
+
+static void trace_open()
+{
+	unsigned int i;
+
+	trace_pid = getpid();
+	for (i = 0; i < sizeof(marker_paths) / sizeof(marker_paths[0]); i++) {
+		trace_fd = open(marker_paths[i], O_WRONLY | O_CLOEXEC);
+		if (trace_fd >= 0)
+			return;
+	}
+	ALOGW("%s: no trace_marker, tracing disabled: %s", __func__,
+		strerror(errno));
+}
+
+static int trace_ready()
+{
+	pthread_once(&trace_once, trace_open);
+	return trace_fd >= 0;
+}
+
+/* one write per marker, the kernel stamps it with time and thread */
+static void trace_write(const char *buf, int len)
+{
+	if (len <= 0)
+		return;
+	if (len >= TRACE_LEN)
+		len = TRACE_LEN - 1;
+	write(trace_fd, buf, len);
+}
+
+void sensors_trace_begin(const char *name)
+{
+	char buf[TRACE_LEN];
+
+	if (trace_ready())
+		trace_write(buf, snprintf(buf, sizeof(buf), "B|%d|%s",
+					  trace_pid, name));
+}
+
+void sensors_trace_end()
+{
+	if (trace_ready())
+		trace_write("E", 1);
+}
+
+void sensors_trace_int(const char *name, int value)
+{
+	char buf[TRACE_LEN];
+
+	if (trace_ready())
+		trace_write(buf, snprintf(buf, sizeof(buf), "C|%d|%s|%d",
+					  trace_pid, name, value));
+}
+
+#endif
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SENSORS_TRACE_H_
+#define SENSORS_TRACE_H_
+
+/*
+ * Trace points along the sample path, written to the ftrace trace_marker
+ * in the format systrace understands so they line up with the scheduler.
+ * Build with -DSENSORS_TRACE, otherwise they compile to nothing.
+ */
+#ifdef SENSORS_TRACE
+void sensors_trace_begin(const char *name);
+void sensors_trace_end();
+void sensors_trace_int(const char *name, int value);
+
+#define TRACE_BEGIN(name)	sensors_trace_begin(name)
+#define TRACE_END()		sensors_trace_end()
+#define TRACE_INT(name, value)	sensors_trace_int(name, value)
+#else
+#define TRACE_BEGIN(name)	do { } while (0)
+#define TRACE_END()		do { } while (0)
+#define TRACE_INT(name, value)	do { (void)(value); } while (0)
+#endif
+
+#endif
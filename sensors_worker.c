@@ -74,10 +74,7 @@ static void sensors_worker_set_delay(struct sensors_worker_t* worker, int64_t ns
 
 static void sensors_worker_suspend(struct sensors_worker_t* worker)
 {
-	enum sensors_worker_mode prev_mode;
-
 	pthread_mutex_lock(&worker->mode_mutex);
-	prev_mode = worker->mode;
 	worker->mode = SENSOR_SLEEP;
 	pthread_mutex_unlock(&worker->mode_mutex);
 }
@@ -22,6 +22,8 @@
 #include <pthread.h>
 #include "sensor_util.h"
 #include "sensors_wrapper.h"
+#include "sensors_trace.h"
+#include "sensors_lockprof.h"
 
 #define UNUSED		0
 #define CLOSE		0x1
@@ -32,12 +34,12 @@
 
 #define LOCK(p) do { \
 	ALOGV_IF(DEBUG_VERBOSE, "%s(%d): %s: lock\n", __FILE__, __LINE__, __func__); \
-	pthread_mutex_lock(p); \
+	PROF_LOCK(p, #p); \
 } while (0)
 
 #define UNLOCK(p) do { \
 	ALOGV_IF(DEBUG_VERBOSE, "%s(%d): %s: unlock\n", __FILE__, __LINE__, __func__); \
-	pthread_mutex_unlock(p); \
+	PROF_UNLOCK(p); \
 } while (0)
 
 pthread_mutex_t wrapper_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -133,12 +135,17 @@ void sensors_wrapper_register(struct sensor_t *sensor,
 	UNLOCK(&wrapper_mutex);
 }
 
-/* find sensor match in list and call all the data api entry functions on it
+/* find sensor match in list and call all the data api entry functions on
+   each of the n samples, all samples must come from the same sensor
    lock and unlock is handled by sensor select to keep the lock order */
-void sensors_wrapper_data(struct sensor_data_t *sd)
+void sensors_wrapper_data_batch(struct sensor_data_t *sd, int n)
 {
 	int i = 0;
 	int j = 0;
+	int k;
+
+	if (n <= 0)
+		return;
 
 	while (sd->sensor != list[i].sensor) {
 		i++;
@@ -149,13 +156,28 @@ void sensors_wrapper_data(struct sensor_data_t *sd)
 		}
 	}
 
+	TRACE_BEGIN("wrapper_data");
 	for (j = 0; j < list[i].entry->nr; j++) {
-		if (list[i].entry->status[j] & ACTIVE) {
-			if (list[i].entry->api[j]->data != NULL)
-				list[i].entry->api[j]->data(
-					list[i].entry->api[j], sd);
+		struct sensor_api_t *api = list[i].entry->api[j];
+
+		if (!(list[i].entry->status[j] & ACTIVE))
+			continue;
+
+		if (api->data_batch) {
+			api->data_batch(api, sd, n);
+			continue;
 		}
+		if (api->data == NULL)
+			continue;
+		for (k = 0; k < n; k++)
+			api->data(api, &sd[k]);
 	}
+	TRACE_END();
+}
+
+void sensors_wrapper_data(struct sensor_data_t *sd)
+{
+	sensors_wrapper_data_batch(sd, 1);
 }
 
 /* match supplied sensor with the entries in the internal wrapper list and
@@ -56,5 +56,6 @@ void sensors_wrapper_register(struct sensor_t *sensor,
 				struct wrapper_entry *entry);
 
 void sensors_wrapper_data(struct sensor_data_t *sd);
+void sensors_wrapper_data_batch(struct sensor_data_t *sd, int n);
 
 #endif
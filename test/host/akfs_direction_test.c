@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AKFS_Direction computes the heading without asin/sin/cos. Check it
+ * against the formulation it replaced over random field and gravity
+ * directions.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "akfs_direction.h"
+#include "akfs_math.h"
+
+#define PAIRS 1000000
+
+/* tolerance in degrees */
+#define AZIMUTH_TOL 0.01
+#define ANGLE_TOL 0.0001
+
+/* below this share of the field in the horizontal plane the heading is
+   not defined well enough to compare */
+#define MIN_HORIZONTAL 0.01
+
+/* the former AKFS_Angle and AKFS_Azimuth, in degrees */
+static void reference(const AKFVEC *h, const AKFVEC *a, AKFLOAT *azimuth,
+		      AKFLOAT *pitch, AKFLOAT *roll, AKFLOAT *horizontal)
+{
+	AKFLOAT av, p, r, sinP, cosP, sinR, cosR, Xh, Yh;
+
+	av = AKFS_SQRT(a->u.x * a->u.x + a->u.y * a->u.y + a->u.z * a->u.z);
+	p = AKFS_ASIN(-(a->u.y) / av);
+	r = AKFS_ASIN((a->u.x) / av);
+
+	sinP = AKFS_SIN(p);
+	cosP = AKFS_COS(p);
+	sinR = AKFS_SIN(r);
+	cosR = AKFS_COS(r);
+	Yh = -(h->u.x) * cosR + (h->u.z) * sinR;
+	Xh = (h->u.x) * sinP * sinR + (h->u.y) * cosP + (h->u.z) * sinP * cosR;
+
+	*azimuth = RAD2DEG(AKFS_ATAN2(Yh, Xh));
+	if (*azimuth < 0)
+		*azimuth += 360.0f;
+	*pitch = RAD2DEG(p);
+	*roll = RAD2DEG(r);
+	*horizontal = AKFS_SQRT(Xh * Xh + Yh * Yh) /
+		AKFS_SQRT(h->u.x * h->u.x + h->u.y * h->u.y + h->u.z * h->u.z);
+}
+
+static void random_vec(AKFVEC *v, AKFLOAT scale)
+{
+	do {
+		v->u.x = 2 * (AKFLOAT)rand() / RAND_MAX - 1;
+		v->u.y = 2 * (AKFLOAT)rand() / RAND_MAX - 1;
+		v->u.z = 2 * (AKFLOAT)rand() / RAND_MAX - 1;
+	} while (v->u.x * v->u.x + v->u.y * v->u.y + v->u.z * v->u.z < 0.01f);
+	v->u.x *= scale;
+	v->u.y *= scale;
+	v->u.z *= scale;
+}
+
+int main()
+{
+	static const int16_t nave[AKFS_VBUF_WIN] = { 1, 1 };
+	AKFS_VBUF hbuf, abuf;
+	AKFVEC h, a, g;
+	AKFLOAT azimuth, pitch, roll;
+	AKFLOAT ref_azimuth, ref_pitch, ref_roll, horizontal;
+	double d, max_azimuth = 0, max_angle = 0;
+	int ret = 1;
+	int i;
+
+	printf("Testing trig-free heading against asin/atan2 ... ");
+	srand(1);
+	AKFS_InitVbuf(&hbuf, nave);
+	AKFS_InitVbuf(&abuf, nave);
+
+	for (i = 0; i < PAIRS; i++) {
+		random_vec(&h, 50);
+		random_vec(&a, 9.8f);
+		AKFS_VbPush(&hbuf, &h);
+		AKFS_VbPush(&abuf, &a);
+
+		if (AKFS_Direction(&hbuf, &abuf, &azimuth, &g) != AKFS_SUCCESS) {
+			printf("\n%u: direction failed!\n", __LINE__);
+			ret = 0;
+			break;
+		}
+		AKFS_Angle(&g, &pitch, &roll);
+		reference(&h, &a, &ref_azimuth, &ref_pitch, &ref_roll,
+			  &horizontal);
+
+		d = fabs(ref_pitch - pitch);
+		if (fabs(ref_roll - roll) > d)
+			d = fabs(ref_roll - roll);
+		if (d > max_angle)
+			max_angle = d;
+		if (d > ANGLE_TOL) {
+			printf("\n%u: pitch %f/%f roll %f/%f!\n", __LINE__,
+			       pitch, ref_pitch, roll, ref_roll);
+			ret = 0;
+			break;
+		}
+
+		if (horizontal < MIN_HORIZONTAL)
+			continue;
+		d = fabs(ref_azimuth - azimuth);
+		if (d > 180)
+			d = 360 - d;
+		if (d > max_azimuth)
+			max_azimuth = d;
+		if (d > AZIMUTH_TOL) {
+			printf("\n%u: azimuth %f, expected %f!\n", __LINE__,
+			       azimuth, ref_azimuth);
+			ret = 0;
+			break;
+		}
+	}
+
+	printf("%s (max error azimuth %g, pitch/roll %g degrees)\n",
+	       ret ? "OK" : "FAILED!", max_azimuth, max_angle);
+	return !ret;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * AKFS_FusionGyro on a device lying still: the gyroscope reads only a
+ * constant bias. The filter has to learn the bias and hold the attitude
+ * of the acc/mag quaternion.
+ */
+#include <stdio.h>
+#include "akfs_direction.h"
+#include "akfs_fusion.h"
+#include "akfs_math.h"
+
+#define RATE_US 10000	/* 100 Hz */
+#define SECONDS 600
+
+/* tolerances, rad/s and degrees */
+#define BIAS_TOL 0.0005
+#define ANGLE_TOL 0.1
+
+/* angle of the rotation from q to r, degrees */
+static double angle(const AKFLOAT q[4], const AKFLOAT r[4])
+{
+	double d = 0;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		d += q[i] * r[i];
+	d = fabs(d);
+	if (d > 1)
+		d = 1;
+	return RAD2DEG(2 * acos(d));
+}
+
+int main()
+{
+	static const int16_t nave[AKFS_VBUF_WIN] = { 1, 1 };
+	static const AKFVEC h = { .u = { 20, -5, -40 } };
+	static const AKFVEC a = { .u = { 1.5f, 2.5f, 9.3f } };
+	static const AKFVEC bias = { .u = { 0.02f, -0.01f, 0.015f } };
+	AKFS_VBUF hbuf, abuf;
+	AKFS_FUSION_VAR fusv;
+	AKFLOAT ref[4];
+	double bias_err = 0, angle_err = 0, d;
+	uint32_t time = 0;
+	int ret = 1;
+	int i;
+
+	printf("Testing gyro fusion with a constant bias ... ");
+	AKFS_InitVbuf(&hbuf, nave);
+	AKFS_InitVbuf(&abuf, nave);
+	AKFS_VbPush(&hbuf, &h);
+	AKFS_VbPush(&abuf, &a);
+	AKFS_InitFusion(&fusv);
+
+	if (AKFS_Quaternion(&hbuf, &abuf, ref) != AKFS_SUCCESS) {
+		printf("\n%u: no acc/mag quaternion!\n", __LINE__);
+		return 1;
+	}
+
+	for (i = 0; i < SECONDS * 1000000 / RATE_US; i++) {
+		time += RATE_US;
+		if (AKFS_FusionGyro(&fusv, &bias, time, &hbuf, &abuf) !=
+		    AKFS_SUCCESS) {
+			printf("\n%u: fusion failed!\n", __LINE__);
+			ret = 0;
+			break;
+		}
+	}
+
+	if (ret) {
+		for (i = 0; i < 3; i++) {
+			d = fabs(fusv.bias.v[i] - bias.v[i]);
+			if (d > bias_err)
+				bias_err = d;
+		}
+		angle_err = angle(fusv.q, ref);
+		if (bias_err > BIAS_TOL) {
+			printf("\n%u: bias %f %f %f, expected %f %f %f!\n",
+			       __LINE__, fusv.bias.u.x, fusv.bias.u.y,
+			       fusv.bias.u.z, bias.u.x, bias.u.y, bias.u.z);
+			ret = 0;
+		} else if (angle_err > ANGLE_TOL) {
+			printf("\n%u: attitude %f degrees off!\n", __LINE__,
+			       angle_err);
+			ret = 0;
+		}
+	}
+
+	printf("%s (bias error %g rad/s, attitude %g degrees)\n",
+	       ret ? "OK" : "FAILED!", bias_err, angle_err);
+	return !ret;
+}
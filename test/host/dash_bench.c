@@ -0,0 +1,446 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Throughput and latency of the poll pipeline on a fake device tree.
+ *
+ * Up to three sensors, each on a different path through the HAL (evdev
+ * driver, xyz driver behind a wrapper, single field evdev driver), are
+ * fed at a fixed rate from one injector thread while the main thread
+ * polls with a given buffer size. Every frame carries a sequence number
+ * in its raw value so the consumer can match it to its injection time,
+ * whatever scaling and axis mapping the driver applies.
+ *
+ * Usage: dash_bench [-n sensors,..] [-r rate_hz,..] [-b count,..]
+ *                   [-d duration_ms]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <hardware/sensors.h>
+#include "fake_device.h"
+
+#define NSEC_PER_SEC 1000000000LL
+#define SEQ_MAX (1 << 20)
+#define DRAIN_TIMEOUT_NS (2 * NSEC_PER_SEC)
+#define MAX_LIST 16
+
+#define GET(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define SET(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+
+extern struct sensors_module_t HAL_MODULE_INFO_SYM;
+
+static const char *bma250_attrs[] = {
+	"bma250_rate", "bma250_range", "bma250_resolution", NULL
+};
+static const char *bmp180_attrs[] = { "bmp180_rate", NULL };
+
+struct bench_sensor {
+	const char *input_name;
+	const char **attrs;
+	const char *phys;	/* i2c device node for xyz drivers */
+	int type;
+	int code[3];
+	int n;
+	double scale;		/* event units per raw lsb */
+	int fd;
+	int handle;
+};
+
+static struct bench_sensor bench_sensors[] = {
+	{ "bma250", bma250_attrs, NULL, SENSOR_TYPE_ACCELEROMETER,
+	  { ABS_X, ABS_Y, ABS_Z }, 3, 9.81 / 256 },
+	{ "l3g4200d_gyr", NULL, "/sys/bus/i2c/devices/1-0068/",
+	  SENSOR_TYPE_GYROSCOPE, { ABS_X, ABS_Y, ABS_Z }, 3,
+	  0.070 * 2 * M_PI / 360 },
+	{ "bmp180", bmp180_attrs, NULL, SENSOR_TYPE_PRESSURE,
+	  { ABS_PRESSURE }, 1, 1 / 100.0 },
+};
+
+#define BENCH_SENSORS (int)(sizeof(bench_sensors) / sizeof(bench_sensors[0]))
+
+struct bench_run {
+	int sensors;
+	int rate;
+	int buf;
+	int64_t duration;
+	int seq_max;
+
+	/* injection time by sequence number, cleared once polled */
+	int64_t *sent[BENCH_SENSORS];
+	int injected;
+	int64_t window;
+	int64_t inject_cpu;
+
+	int consumer_done;
+	int give_up;
+};
+
+static int64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int64_t cpu_ns(int who)
+{
+	struct rusage ru;
+
+	getrusage(who, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * NSEC_PER_SEC +
+		(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000LL;
+}
+
+static void sleep_until(int64_t t)
+{
+	struct timespec ts = {
+		.tv_sec = t / NSEC_PER_SEC,
+		.tv_nsec = t % NSEC_PER_SEC,
+	};
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+		;
+}
+
+/* the magnitude does not depend on axis mapping or sign */
+static int decode(struct bench_sensor *s, const sensors_event_t *e)
+{
+	double m = 0;
+	int i;
+
+	for (i = 0; i < s->n; i++)
+		m += (double)e->data[i] * e->data[i];
+	return (int)lround(sqrt(m) / s->scale);
+}
+
+static int send_frame(struct bench_sensor *s, int seq)
+{
+	int value[3] = { seq, 0, 0 };
+
+	return fake_evdev_abs(s->fd, s->code, value, s->n);
+}
+
+static void *inject(void *arg)
+{
+	struct bench_run *r = arg;
+	int64_t period = NSEC_PER_SEC / r->rate;
+	int64_t next[BENCH_SENSORS];
+	int seq[BENCH_SENSORS];
+	int64_t start, end, now;
+	int i, s;
+
+	start = now_ns() + NSEC_PER_SEC / 1000;
+	end = start + r->duration;
+	for (i = 0; i < r->sensors; i++) {
+		next[i] = start + i * period / r->sensors;
+		seq[i] = 1;
+	}
+
+	for (;;) {
+		for (s = 0, i = 1; i < r->sensors; i++)
+			if (next[i] < next[s])
+				s = i;
+		if (next[s] >= end || seq[s] > r->seq_max)
+			break;
+
+		sleep_until(next[s]);
+		SET(&r->sent[s][seq[s]], now_ns());
+		if (send_frame(&bench_sensors[s], seq[s]))
+			break;
+		seq[s]++;
+		r->injected++;
+
+		/* when late, do not make up for it with a burst */
+		next[s] += period;
+		now = now_ns();
+		if (next[s] < now - 10 * period)
+			next[s] = now;
+	}
+	now = now_ns();
+	r->window = now - start;
+
+	/* sequence 0 ends a stream; frames behind it were delivered or lost */
+	end = now + DRAIN_TIMEOUT_NS;
+	while (!GET(&r->consumer_done)) {
+		for (i = 0; i < r->sensors; i++)
+			send_frame(&bench_sensors[i], 0);
+		if (now_ns() > end)
+			SET(&r->give_up, 1);
+		usleep(1000);
+	}
+
+	r->inject_cpu = cpu_ns(RUSAGE_THREAD);
+	return NULL;
+}
+
+static int cmp_ns(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a;
+	int64_t y = *(const int64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static double pct_us(const int64_t *lat, int n, double q)
+{
+	int i = (int)(q * n);
+
+	if (!n)
+		return 0;
+	return lat[i < n ? i : n - 1] / 1000.0;
+}
+
+static int run(struct sensors_poll_device_t *dev, struct bench_run *r)
+{
+	sensors_event_t *data;
+	pthread_t injector;
+	int64_t *lat;
+	int64_t cpu, now, t;
+	int drained = 0;
+	int nlat = 0;
+	int i, j, n, s, seq;
+
+	r->seq_max = (int)(r->rate * r->duration / NSEC_PER_SEC) + 1;
+	if (r->seq_max >= SEQ_MAX)
+		r->seq_max = SEQ_MAX - 1;
+
+	data = malloc(r->buf * sizeof(*data));
+	lat = malloc((size_t)r->sensors * (r->seq_max + 1) * sizeof(*lat));
+	if (!data || !lat)
+		goto error;
+	for (i = 0; i < r->sensors; i++) {
+		r->sent[i] = calloc(r->seq_max + 1, sizeof(int64_t));
+		if (!r->sent[i])
+			goto error;
+	}
+
+	for (i = 0; i < r->sensors; i++) {
+		if (dev->activate(dev, bench_sensors[i].handle, 1) ||
+		    dev->setDelay(dev, bench_sensors[i].handle,
+				  NSEC_PER_SEC / r->rate)) {
+			printf("# unable to activate %s\n",
+			       bench_sensors[i].input_name);
+			goto error;
+		}
+	}
+
+	cpu = cpu_ns(RUSAGE_SELF);
+	if (pthread_create(&injector, NULL, inject, r))
+		goto error;
+
+	while (drained != (1 << r->sensors) - 1 && !GET(&r->give_up)) {
+		n = dev->poll(dev, data, r->buf);
+		now = now_ns();
+		for (i = 0; i < n; i++) {
+			for (s = 0; s < r->sensors; s++)
+				if (data[i].sensor == bench_sensors[s].handle)
+					break;
+			if (s == r->sensors)
+				continue;
+			seq = decode(&bench_sensors[s], &data[i]);
+			if (!seq) {
+				drained |= 1 << s;
+				continue;
+			}
+			if (seq > r->seq_max)
+				continue;
+			t = __atomic_exchange_n(&r->sent[s][seq], 0,
+						__ATOMIC_RELAXED);
+			if (t)
+				lat[nlat++] = now - t;
+		}
+	}
+	SET(&r->consumer_done, 1);
+	pthread_join(injector, NULL);
+	cpu = cpu_ns(RUSAGE_SELF) - cpu - r->inject_cpu;
+
+	for (i = 0; i < r->sensors; i++)
+		dev->activate(dev, bench_sensors[i].handle, 0);
+
+	qsort(lat, nlat, sizeof(*lat), cmp_ns);
+	printf("%7d %7d %5d %10.0f %10.0f %6.2f %8.2f %9.1f %9.1f %9.1f "
+	       "%9.1f%s\n", r->sensors, r->rate, r->buf,
+	       r->injected * (double)NSEC_PER_SEC / r->window,
+	       nlat * (double)NSEC_PER_SEC / r->window,
+	       r->injected ? 100.0 * (r->injected - nlat) / r->injected : 0,
+	       nlat ? cpu / 1000.0 / nlat : 0,
+	       pct_us(lat, nlat, 0.5), pct_us(lat, nlat, 0.99),
+	       pct_us(lat, nlat, 0.999), pct_us(lat, nlat, 1),
+	       GET(&r->give_up) ? " (drain timeout)" : "");
+	fflush(stdout);
+
+	for (j = 0; j < r->sensors; j++)
+		free(r->sent[j]);
+	free(lat);
+	free(data);
+	return 0;
+
+error:
+	for (j = 0; j < r->sensors; j++)
+		free(r->sent[j]);
+	free(lat);
+	free(data);
+	return -1;
+}
+
+static int parse_list(const char *arg, int *list)
+{
+	char *end;
+	int n = 0;
+
+	while (*arg && n < MAX_LIST) {
+		list[n] = strtol(arg, &end, 0);
+		if (end == arg || list[n] <= 0)
+			return -1;
+		n++;
+		arg = *end == ',' ? end + 1 : end;
+	}
+	return *arg ? -1 : n;
+}
+
+static int add_devices(struct fake_root *root)
+{
+	char path[PATH_MAX];
+	struct bench_sensor *s;
+	int i;
+
+	for (i = 0; i < BENCH_SENSORS; i++) {
+		s = &bench_sensors[i];
+		s->fd = fake_evdev_add(root, i, s->input_name, s->attrs);
+		if (s->fd < 0)
+			return -1;
+		if (!s->phys)
+			continue;
+		snprintf(path, sizeof(path), "%sname", s->phys);
+		if (fake_file_write(root, path, s->input_name))
+			return -1;
+		snprintf(path, sizeof(path), "%spollrate_ms", s->phys);
+		if (fake_file_write(root, path, ""))
+			return -1;
+	}
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n sensors,..] [-r rate_hz,..] "
+		"[-b count,..] [-d duration_ms]\n", name);
+}
+
+int main(int argc, char *argv[])
+{
+	int counts[MAX_LIST] = { 1, 2, 3 };
+	int rates[MAX_LIST] = { 100, 1000, 5000 };
+	int bufs[MAX_LIST] = { 1, 16, 128 };
+	int ncounts = 3, nrates = 3, nbufs = 3;
+	int duration_ms = 1000;
+	struct sensors_poll_device_t *dev = NULL;
+	struct sensor_t const *list;
+	struct bench_run r;
+	struct fake_root root;
+	int rc = 1;
+	int c, i, j, k, n;
+
+	while ((c = getopt(argc, argv, "n:r:b:d:")) != -1) {
+		switch (c) {
+		case 'n':
+			ncounts = parse_list(optarg, counts);
+			break;
+		case 'r':
+			nrates = parse_list(optarg, rates);
+			break;
+		case 'b':
+			nbufs = parse_list(optarg, bufs);
+			break;
+		case 'd':
+			duration_ms = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (ncounts <= 0 || nrates <= 0 || nbufs <= 0 || duration_ms <= 0) {
+		usage(argv[0]);
+		return 1;
+	}
+	for (i = 0; i < ncounts; i++) {
+		if (counts[i] > BENCH_SENSORS) {
+			fprintf(stderr, "at most %d sensors\n", BENCH_SENSORS);
+			return 1;
+		}
+	}
+
+	if (fake_root_create(&root) < 0) {
+		perror("fake root");
+		return 1;
+	}
+	if (add_devices(&root)) {
+		perror("fake devices");
+		goto exit;
+	}
+
+	if (HAL_MODULE_INFO_SYM.common.methods->open(
+			&HAL_MODULE_INFO_SYM.common, SENSORS_HARDWARE_POLL,
+			(struct hw_device_t **)&dev) || !dev) {
+		fprintf(stderr, "unable to open the HAL\n");
+		goto exit;
+	}
+	n = HAL_MODULE_INFO_SYM.get_sensors_list(&HAL_MODULE_INFO_SYM, &list);
+	for (i = 0; i < BENCH_SENSORS; i++) {
+		bench_sensors[i].handle = -1;
+		for (j = 0; j < n; j++)
+			if (list[j].type == bench_sensors[i].type)
+				bench_sensors[i].handle = list[j].handle;
+		if (bench_sensors[i].handle < 0) {
+			fprintf(stderr, "no sensor for %s\n",
+				bench_sensors[i].input_name);
+			goto exit;
+		}
+	}
+
+	printf("# latency from injection to poll return, cpu excludes the "
+	       "injector\n");
+	printf("# sensors rate_hz count offered/s delivered/s drop%% "
+	       "cpu_us/ev p50_us p99_us p999_us max_us\n");
+	for (i = 0; i < ncounts; i++) {
+		for (j = 0; j < nrates; j++) {
+			for (k = 0; k < nbufs; k++) {
+				memset(&r, 0, sizeof(r));
+				r.sensors = counts[i];
+				r.rate = rates[j];
+				r.buf = bufs[k];
+				r.duration = duration_ms * 1000000LL;
+				if (run(dev, &r))
+					goto exit;
+			}
+		}
+	}
+	rc = 0;
+
+exit:
+	if (dev)
+		dev->common.close(&dev->common);
+	fake_root_destroy(&root);
+	return rc;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * End-to-end run of the HAL against a fake device tree: open the module,
+ * activate the accelerometer and the light sensor, feed frames through
+ * their input pipes and check what poll returns.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <hardware/sensors.h>
+#include "sensors_id.h"
+#include "fake_device.h"
+
+#define FRAMES 200
+#define LIGHT_SAMPLES 50
+
+extern struct sensors_module_t HAL_MODULE_INFO_SYM;
+
+static const char *bma250_attrs[] = {
+	"bma250_rate", "bma250_range", "bma250_resolution", NULL
+};
+
+static int feed_fd;
+static int light_fd;
+static volatile int light_done;
+
+/* poll only sees events put after it started waiting, so keep feeding */
+static void *feed(void *arg)
+{
+	int value[3];
+	int i;
+
+	for (i = 0; i < FRAMES; i++) {
+		value[0] = i;
+		value[1] = 2 * i;
+		value[2] = 256;
+		if (fake_evdev_frame(feed_fd, value, 3))
+			break;
+		usleep(2000);
+	}
+	return NULL;
+}
+
+/* light samples count up, so a sample reported twice shows */
+static void *feed_light(void *arg)
+{
+	int i;
+
+	for (i = 1; !light_done; i++) {
+		if (fake_evdev_msc(light_fd, MSC_RAW, i))
+			break;
+		usleep(2000);
+	}
+	return NULL;
+}
+
+int main()
+{
+	struct fake_root root;
+	struct sensors_poll_device_t *dev = NULL;
+	struct sensor_t const *list;
+	sensors_event_t data[16];
+	pthread_t feeder;
+	char stats_path[PATH_MAX];
+	char buf[32];
+	int handle = -1;
+	int light = -1;
+	float last = 0;
+	int seen = 0;
+	int ret = 1;
+	int i, n;
+
+	printf("Testing HAL on a fake device ... ");
+	if (fake_root_create(&root) < 0) {
+		printf("\n%u: unable to create fake root!\n", __LINE__);
+		return 1;
+	}
+	if (snprintf(stats_path, sizeof(stats_path),
+		     "%s/data/misc/sensors/dash_stats.txt", root.path) >=
+	    (int)sizeof(stats_path)) {
+		printf("\n%u: fake root path too long!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	feed_fd = fake_evdev_add(&root, 0, "bma250", bma250_attrs);
+	if (feed_fd < 0) {
+		printf("\n%u: unable to create fake evdev!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	light_fd = fake_evdev_add(&root, 1, "system_als", NULL);
+	if (light_fd < 0) {
+		printf("\n%u: unable to create fake evdev!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	if (HAL_MODULE_INFO_SYM.common.methods->open(
+			&HAL_MODULE_INFO_SYM.common, SENSORS_HARDWARE_POLL,
+			(struct hw_device_t **)&dev) || !dev) {
+		printf("\n%u: open should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	n = HAL_MODULE_INFO_SYM.get_sensors_list(&HAL_MODULE_INFO_SYM, &list);
+	for (i = 0; i < n; i++)
+		if (list[i].type == SENSOR_TYPE_ACCELEROMETER)
+			handle = list[i].handle;
+		else if (list[i].type == SENSOR_TYPE_LIGHT)
+			light = list[i].handle;
+	if (handle < 0 || light < 0) {
+		printf("\n%u: no accelerometer or light in the list!\n",
+		       __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	if (dev->activate(dev, handle, 1) ||
+	    dev->setDelay(dev, handle, 20000000)) {
+		printf("\n%u: activate should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (fake_file_read(&root, "/sys/class/input/input0/bma250_rate", buf,
+			   sizeof(buf)) < 0 || strcmp(buf, "20")) {
+		printf("\n%u: rate not written to sysfs!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	pthread_create(&feeder, NULL, feed, NULL);
+	while (seen < FRAMES / 2) {
+		n = dev->poll(dev, data, 16);
+		for (i = 0; i < n; i++) {
+			if (data[i].sensor != handle)
+				continue;
+			/* bma250 defaults: x and y negated, 256 lsb/g */
+			if (data[i].acceleration.x > 0 ||
+			    data[i].acceleration.x * 2 !=
+			    data[i].acceleration.y ||
+			    data[i].acceleration.z < 9.8f ||
+			    data[i].acceleration.z > 9.82f) {
+				printf("\n%u: bad sample %f %f %f!\n", __LINE__,
+				       data[i].acceleration.x,
+				       data[i].acceleration.y,
+				       data[i].acceleration.z);
+				ret = 0;
+				break;
+			}
+			seen++;
+		}
+		if (!ret)
+			break;
+	}
+	pthread_join(feeder, NULL);
+	if (!ret)
+		goto exit;
+
+	/* EV_MSC reports the light frame, its SYN_REPORT must not again */
+	if (dev->activate(dev, light, 1)) {
+		printf("\n%u: light activate should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	pthread_create(&feeder, NULL, feed_light, NULL);
+	for (seen = 0; seen < LIGHT_SAMPLES && ret; ) {
+		n = dev->poll(dev, data, 16);
+		for (i = 0; i < n; i++) {
+			if (data[i].sensor != light)
+				continue;
+			if (data[i].light <= last) {
+				printf("\n%u: light %f reported after %f!\n",
+				       __LINE__, data[i].light, last);
+				ret = 0;
+				break;
+			}
+			last = data[i].light;
+			seen++;
+		}
+	}
+	light_done = 1;
+	pthread_join(feeder, NULL);
+	dev->activate(dev, light, 0);
+	if (!ret)
+		goto exit;
+
+	if (dev->activate(dev, SENSOR_STATS_HANDLE, 1) ||
+	    fake_file_read(&root, "/data/misc/sensors/dash_stats.txt", buf,
+			   sizeof(buf)) <= 0) {
+		printf("\n%u: stats dump should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	/* on a device the dump is requested through a file */
+	unlink(stats_path);
+	if (fake_file_write(&root, "/data/misc/sensors/dash_stats.req", "")) {
+		printf("\n%u: unable to request a stats dump!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	for (i = 0; i < 100 && access(stats_path, F_OK); i++)
+		usleep(10000);
+	if (access(stats_path, F_OK)) {
+		printf("\n%u: requested stats dump not written!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	dev->activate(dev, handle, 0);
+
+exit:
+	printf("%s\n", ret ? "OK" : "FAILED!");
+	if (dev)
+		dev->common.close(&dev->common);
+	fake_root_destroy(&root);
+	return !ret;
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include "fake_device.h"
+
+/* create every directory leading to path, end with / to include it */
+static int make_dirs(const char *path)
+{
+	char buf[PATH_MAX];
+	char *p;
+
+	snprintf(buf, sizeof(buf), "%s", path);
+	for (p = buf + 1; (p = strchr(p, '/')) != NULL; p++) {
+		*p = 0;
+		if (mkdir(buf, 0755) < 0 && errno != EEXIST)
+			return -1;
+		*p = '/';
+	}
+	return 0;
+}
+
+int fake_root_create(struct fake_root *r)
+{
+	const char *tmp = getenv("TMPDIR");
+	char buf[PATH_MAX];
+
+	snprintf(r->path, sizeof(r->path), "%s/dash.XXXXXX",
+		 tmp ? tmp : "/tmp");
+	if (!mkdtemp(r->path))
+		return -1;
+
+	/* where the HAL keeps its state on a device */
+	if (snprintf(buf, sizeof(buf), "%s/data/misc/sensors/", r->path) >=
+	    (int)sizeof(buf) || make_dirs(buf) < 0)
+		return -1;
+	return setenv("DASH_ROOT", r->path, 1);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag,
+			struct FTW *ftw)
+{
+	return remove(path);
+}
+
+void fake_root_destroy(struct fake_root *r)
+{
+	nftw(r->path, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	unsetenv("DASH_ROOT");
+}
+
+int fake_file_write(struct fake_root *r, const char *path, const char *val)
+{
+	char buf[PATH_MAX];
+	FILE *f;
+
+	snprintf(buf, sizeof(buf), "%s%s", r->path, path);
+	if (make_dirs(buf))
+		return -1;
+	f = fopen(buf, "w");
+	if (!f)
+		return -1;
+	fputs(val, f);
+	return fclose(f);
+}
+
+int fake_file_read(struct fake_root *r, const char *path, char *buf, int len)
+{
+	char name[PATH_MAX];
+	int fd;
+	int n;
+
+	snprintf(name, sizeof(name), "%s%s", r->path, path);
+	fd = open(name, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	n = read(fd, buf, len - 1);
+	close(fd);
+	if (n < 0)
+		return -1;
+	buf[n] = 0;
+	return n;
+}
+
+int fake_evdev_add(struct fake_root *r, int nr, const char *name,
+		   const char **attrs)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	snprintf(path, sizeof(path), "/sys/class/input/event%d/device/name",
+		 nr);
+	if (fake_file_write(r, path, name))
+		return -1;
+	for (; attrs && *attrs; attrs++) {
+		snprintf(path, sizeof(path), "/sys/class/input/input%d/%s",
+			 nr, *attrs);
+		if (fake_file_write(r, path, ""))
+			return -1;
+	}
+
+	if (snprintf(path, sizeof(path), "%s/dev/input/event%d", r->path,
+		     nr) >= (int)sizeof(path) ||
+	    make_dirs(path) || mkfifo(path, 0644))
+		return -1;
+
+	/* read-write so the HAL never sees the pipe without a writer */
+	fd = open(path, O_RDWR | O_CLOEXEC);
+	if (fd >= 0)
+		fcntl(fd, F_SETPIPE_SZ, 1 << 20);
+	return fd;
+}
+
+static int write_frame(int fd, int type, const int *code, const int *value,
+		       int n)
+{
+	struct input_event ev[FAKE_EVDEV_MAX_ABS + 1];
+	struct timeval now;
+	int i;
+
+	if (n > FAKE_EVDEV_MAX_ABS)
+		return -1;
+
+	gettimeofday(&now, NULL);
+	memset(ev, 0, sizeof(ev));
+	for (i = 0; i < n; i++) {
+		ev[i].time = now;
+		ev[i].type = type;
+		ev[i].code = code[i];
+		ev[i].value = value[i];
+	}
+	ev[n].time = now;
+	ev[n].type = EV_SYN;
+	ev[n].code = SYN_REPORT;
+
+	/* one write, so the reader never sees half a frame */
+	return write(fd, ev, (n + 1) * sizeof(ev[0])) ==
+		(ssize_t)((n + 1) * sizeof(ev[0])) ? 0 : -1;
+}
+
+int fake_evdev_abs(int fd, const int *code, const int *value, int n)
+{
+	return write_frame(fd, EV_ABS, code, value, n);
+}
+
+int fake_evdev_msc(int fd, int code, int value)
+{
+	return write_frame(fd, EV_MSC, &code, &value, 1);
+}
+
+int fake_evdev_frame(int fd, const int *value, int n)
+{
+	static const int xyz[] = { ABS_X, ABS_Y, ABS_Z };
+
+	if (n > (int)(sizeof(xyz) / sizeof(xyz[0])))
+		return -1;
+	return fake_evdev_abs(fd, xyz, value, n);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_DEVICE_H_
+#define FAKE_DEVICE_H_
+#include <limits.h>
+#include <linux/input.h>
+
+/*
+ * A fake device tree in a temporary directory, exported as $DASH_ROOT
+ * to a HAL built with -DSENSORS_HOST. Input devices are named pipes
+ * named through sysfs, sysfs attributes are plain files.
+ */
+struct fake_root {
+	char path[PATH_MAX];
+};
+
+int fake_root_create(struct fake_root *r);
+void fake_root_destroy(struct fake_root *r);
+int fake_file_write(struct fake_root *r, const char *path, const char *val);
+int fake_file_read(struct fake_root *r, const char *path, char *buf,
+		   int len);
+
+/* add /dev/input/event<nr> named name, returns the fd to feed it */
+int fake_evdev_add(struct fake_root *r, int nr, const char *name,
+		   const char **attrs);
+
+#define FAKE_EVDEV_MAX_ABS 8
+/* one frame: n EV_ABS code/value pairs followed by SYN_REPORT */
+int fake_evdev_abs(int fd, const int *code, const int *value, int n);
+/* same, for codes ABS_X.. */
+int fake_evdev_frame(int fd, const int *value, int n);
+/* one EV_MSC event followed by SYN_REPORT */
+int fake_evdev_msc(int fd, int code, int value);
+
+#endif
@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "host_compat.h"
+#include <lights/illumination_api.h>
+
+__attribute__((weak))
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t len = strlen(src);
+	size_t n = len < size ? len : size - 1;
+
+	if (size) {
+		memcpy(dst, src, n);
+		dst[n] = 0;
+	}
+	return len;
+}
+
+/* the illumination service: the fake light evdev is always running */
+int sysals_activate(void)
+{
+	return 0;
+}
+
+void sysals_deactivate(void)
+{
+}
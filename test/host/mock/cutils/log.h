@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LOG_H_
+#define LOG_H_
+#include <stdio.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG
+#endif
+
+#ifndef VERBOSE
+#define VERBOSE 0
+#endif
+
+#define ALOG(x...) do { \
+	fprintf(stderr, LOG_TAG ": " x); \
+	fprintf(stderr, "\n"); \
+} while (0)
+
+/* errors are always shown, the rest only with VERBOSE */
+#define ALOGE(x...) ALOG(x)
+#define ALOGE_IF(c, x...) do { if (c) ALOG(x); } while (0)
+#if VERBOSE
+#define ALOGW(x...) ALOG(x)
+#define ALOGI(x...) ALOG(x)
+#define ALOGD(x...) ALOG(x)
+#define ALOGV(x...) ALOG(x)
+#define ALOGW_IF(c, x...) do { if (c) ALOG(x); } while (0)
+#define ALOGI_IF(c, x...) do { if (c) ALOG(x); } while (0)
+#define ALOGD_IF(c, x...) do { if (c) ALOG(x); } while (0)
+#define ALOGV_IF(c, x...) do { if (c) ALOG(x); } while (0)
+#else
+#define ALOGW(x...) do { } while (0)
+#define ALOGI(x...) do { } while (0)
+#define ALOGD(x...) do { } while (0)
+#define ALOGV(x...) do { } while (0)
+#define ALOGW_IF(c, x...) do { } while (0)
+#define ALOGI_IF(c, x...) do { } while (0)
+#define ALOGD_IF(c, x...) do { } while (0)
+#define ALOGV_IF(c, x...) do { } while (0)
+#endif
+
+#endif
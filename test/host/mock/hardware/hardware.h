@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* The parts of the Android hardware module interface the HAL uses. */
+#ifndef ANDROID_INCLUDE_HARDWARE_HARDWARE_H
+#define ANDROID_INCLUDE_HARDWARE_HARDWARE_H
+#include <stdint.h>
+
+#define HARDWARE_MODULE_TAG 0x484d5420 /* "HWMT" */
+#define HARDWARE_DEVICE_TAG 0x48574454 /* "HWDT" */
+
+struct hw_module_t;
+struct hw_device_t;
+
+struct hw_module_methods_t {
+	int (*open)(const struct hw_module_t *module, const char *id,
+		    struct hw_device_t **device);
+};
+
+struct hw_module_t {
+	uint32_t tag;
+	uint16_t version_major;
+	uint16_t version_minor;
+	const char *id;
+	const char *name;
+	const char *author;
+	struct hw_module_methods_t *methods;
+	void *dso;
+	uint32_t reserved[32 - 7];
+};
+
+struct hw_device_t {
+	uint32_t tag;
+	uint32_t version;
+	struct hw_module_t *module;
+	uint32_t reserved[12];
+	int (*close)(struct hw_device_t *device);
+};
+
+#endif
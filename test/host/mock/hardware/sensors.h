@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2012 Sony Mobile Communications AB.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/* The parts of the Android sensors HAL interface the HAL uses. */
+#ifndef ANDROID_SENSORS_INTERFACE_H
+#define ANDROID_SENSORS_INTERFACE_H
+#include <stdint.h>
+#include <hardware/hardware.h>
+
+#define SENSORS_HARDWARE_MODULE_ID "sensors"
+#define SENSORS_HARDWARE_POLL "poll"
+#define SENSORS_DEVICE_API_VERSION_0_1 1
+
+#define SENSOR_TYPE_ACCELEROMETER 1
+#define SENSOR_TYPE_MAGNETIC_FIELD 2
+#define SENSOR_TYPE_ORIENTATION 3
+#define SENSOR_TYPE_GYROSCOPE 4
+#define SENSOR_TYPE_LIGHT 5
+#define SENSOR_TYPE_PRESSURE 6
+#define SENSOR_TYPE_TEMPERATURE 7
+#define SENSOR_TYPE_PROXIMITY 8
+#define SENSOR_TYPE_GRAVITY 9
+#define SENSOR_TYPE_LINEAR_ACCELERATION 10
+#define SENSOR_TYPE_ROTATION_VECTOR 11
+#define SENSOR_TYPE_RELATIVE_HUMIDITY 12
+#define SENSOR_TYPE_AMBIENT_TEMPERATURE 13
+#define SENSOR_TYPE_MAGNETIC_FIELD_UNCALIBRATED 14
+#define SENSOR_TYPE_GAME_ROTATION_VECTOR 15
+#define SENSOR_TYPE_GYROSCOPE_UNCALIBRATED 16
+#define SENSOR_TYPE_GEOMAGNETIC_ROTATION_VECTOR 20
+
+#define SENSOR_STATUS_UNRELIABLE 0
+#define SENSOR_STATUS_ACCURACY_LOW 1
+#define SENSOR_STATUS_ACCURACY_MEDIUM 2
+#define SENSOR_STATUS_ACCURACY_HIGH 3
+
+#define GRAVITY_EARTH (9.80665f)
+
+typedef struct {
+	union {
+		float v[3];
+		struct {
+			float x;
+			float y;
+			float z;
+		};
+		struct {
+			float azimuth;
+			float pitch;
+			float roll;
+		};
+	};
+	int8_t status;
+	uint8_t reserved[3];
+} sensors_vec_t;
+
+typedef struct {
+	union {
+		float uncalib[3];
+		struct {
+			float x_uncalib;
+			float y_uncalib;
+			float z_uncalib;
+		};
+	};
+	union {
+		float bias[3];
+		struct {
+			float x_bias;
+			float y_bias;
+			float z_bias;
+		};
+	};
+} uncalibrated_event_t;
+
+typedef struct sensors_event_t {
+	int32_t version;
+	int32_t sensor;
+	int32_t type;
+	int32_t reserved0;
+	int64_t timestamp;
+	union {
+		float data[16];
+		sensors_vec_t acceleration;
+		sensors_vec_t magnetic;
+		sensors_vec_t orientation;
+		sensors_vec_t gyro;
+		float temperature;
+		float distance;
+		float light;
+		float pressure;
+		float relative_humidity;
+		uncalibrated_event_t uncalibrated_gyro;
+		uncalibrated_event_t uncalibrated_magnetic;
+	};
+	uint32_t flags;
+	uint32_t reserved1[3];
+} sensors_event_t;
+
+struct sensor_t {
+	const char *name;
+	const char *vendor;
+	int version;
+	int handle;
+	int type;
+	float maxRange;
+	float resolution;
+	float power;
+	int32_t minDelay;
+	void *reserved[8];
+};
+
+struct sensors_module_t {
+	struct hw_module_t common;
+	int (*get_sensors_list)(struct sensors_module_t *module,
+				struct sensor_t const **list);
+};
+
+struct sensors_poll_device_t {
+	struct hw_device_t common;
+	int (*activate)(struct sensors_poll_device_t *dev, int handle,
+			int enabled);
+	int (*setDelay)(struct sensors_poll_device_t *dev, int handle,
+			int64_t ns);
+	int (*poll)(struct sensors_poll_device_t *dev, sensors_event_t *data,
+		    int count);
+};
+
+#endif
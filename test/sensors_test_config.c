@@ -15,14 +15,75 @@
  */
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "sensors_config.h"
 
+static int reloads;
+
+static void count_reloads(struct sensors_config_notifier *n)
+{
+	reloads++;
+}
+
+static struct sensors_config_notifier notifier = {
+	.reload = count_reloads,
+};
+
+static int write_config(const char *path, const char *text)
+{
+	FILE *fp = fopen(path, "w");
+
+	if (!fp)
+		return -1;
+	if (fputs(text, fp) < 0) {
+		fclose(fp);
+		return -1;
+	}
+	return fclose(fp);
+}
+
+/* overwrite the first occurrence of from in path with to, same length */
+static int garble(const char *path, const char *from, const char *to)
+{
+	size_t len = strlen(from);
+	char buf[4096];
+	FILE *fp;
+	size_t i, n;
+	int rc = -1;
+
+	fp = fopen(path, "r+b");
+	if (!fp)
+		return -1;
+	n = fread(buf, 1, sizeof(buf), fp);
+	for (i = 0; i + len <= n; i++) {
+		if (memcmp(buf + i, from, len))
+			continue;
+		if (!fseek(fp, i, SEEK_SET) && fwrite(to, len, 1, fp) == 1)
+			rc = 0;
+		break;
+	}
+	if (fclose(fp))
+		rc = -1;
+	return rc;
+}
+
+static int name_is(const char *name)
+{
+	char out_str[16];
+
+	return sensors_config_get_key("akm8973", "name", TYPE_STRING,
+				      (void*)&out_str, sizeof(out_str)) >= 0 &&
+		!strcmp(out_str, name);
+}
+
 int main()
 {
+	FILE *fp;
 	int ret = 1;
 	int out_int = 0;
-	char out_str[64];
-	int out_array[2];
+	char out_str[128];
+	int out_array[3];
+	int out_layout[21];
 
 	printf("Testing sensor config ... ");
 	if (sensors_have_config_file() != 0) {
@@ -71,6 +132,31 @@ int main()
 		ret = 0;
 		goto exit;
 	}
+	if (sensors_config_get_key("bma150", "layout", TYPE_STRING, (void*)&out_str, sizeof(out_str)) < 0) {
+		printf("\n%u: sensors_config_get_key should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (strlen(out_str) != 90) {
+		printf("\n%u: long value truncated!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_get_key("bma150", "layout", TYPE_ARRAY_INT, (void*)&out_layout, 21) < 0) {
+		printf("\n%u: sensors_config_get_key should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if ((out_layout[0] != 1000) || (out_layout[1] != -1000) || (out_layout[20] != 0)) {
+		printf("\n%u: out_layout != 1000 -1000 ... 0\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_get_key("bma", "axis_x", TYPE_ARRAY_INT, (void*)&out_array, 3) >= 0) {
+		printf("\n%u: sensors_config_get_key should fail!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
 	if (sensors_config_get_key("akm8973", "version", TYPE_INT, (void*)&out_int, sizeof(out_int)-1) >= 0) {
 		printf("\n%u: sensors_config_get_key should fail!\n", __LINE__);
 		ret = 0;
@@ -86,9 +172,110 @@ int main()
 		ret = 0;
 		goto exit;
 	}
+	sensors_config_destroy();
+	if (sensors_config_compile("./config_test_1", "./config_test_1.bin") < 0) {
+		printf("\n%u: sensors_config_compile should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_read("./config_test_1") < 0) {
+		printf("\n%u: sensors_config_read should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_get_key("bma150", "axis_y", TYPE_ARRAY_INT, (void*)&out_array, 3) < 0) {
+		printf("\n%u: sensors_config_get_key should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if ((out_array[0] != 0)	|| (out_array[1] != 1) || (out_array[2] != 0)) {
+		printf("\n%u: out_array != 0 1 0\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_get_key("akm8973", "name", TYPE_STRING, (void*)&out_str, sizeof(out_str)) < 0) {
+		printf("\n%u: sensors_config_get_key should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (strcmp(out_str, "Hej") != 0) {
+		printf("\n%u: out_str != Hej\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	unlink("./config_test_1.bin");
+
+	/* with the text gone only the mapped image can answer */
+	if (write_config("./config_test_bin", "akm8973_name = Hej\n") ||
+	    sensors_config_compile("./config_test_bin",
+				   "./config_test_bin.bin") < 0) {
+		printf("\n%u: sensors_config_compile should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	unlink("./config_test_bin");
+	if (sensors_config_read("./config_test_bin") < 0 || !name_is("Hej")) {
+		printf("\n%u: compiled config not loaded!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	/* same size, same second: only the nanoseconds tell the image is old */
+	if (write_config("./config_test_bin", "akm8973_name = Hoj\n") ||
+	    sensors_config_read("./config_test_bin") < 0 || !name_is("Hoj")) {
+		printf("\n%u: older compiled config should be ignored!\n",
+		       __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_compile("./config_test_bin",
+				   "./config_test_bin.bin") < 0 ||
+	    garble("./config_test_bin.bin", "Hoj", "Hax") ||
+	    sensors_config_read("./config_test_bin") < 0 || !name_is("Hoj")) {
+		printf("\n%u: corrupt compiled config should be ignored!\n",
+		       __LINE__);
+		ret = 0;
+		goto exit;
+	}
+
+	sensors_config_register_notifier(&notifier);
+	fp = fopen("./config_test_reload", "w");
+	if (!fp || fprintf(fp, "akm8973_version = 2\n") < 0 || fclose(fp)) {
+		printf("\n%u: failed to write config!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_read("./config_test_1") < 0 ||
+	    sensors_config_reload() < 0 || reloads != 1) {
+		printf("\n%u: sensors_config_reload should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_read("./config_test_reload") < 0 ||
+	    sensors_config_reload() < 0 || reloads != 2) {
+		printf("\n%u: sensors_config_reload should succeed!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	if (sensors_config_get_key("akm8973", "version", TYPE_INT, (void*)&out_int, sizeof(out_int)) < 0 ||
+	    out_int != 2) {
+		printf("\n%u: out_int != 2!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
+	unlink("./config_test_reload");
+	if (sensors_config_reload() >= 0 || reloads != 2 ||
+	    sensors_config_get_key("akm8973", "version", TYPE_INT, (void*)&out_int, sizeof(out_int)) < 0) {
+		printf("\n%u: failed reload should keep old config!\n", __LINE__);
+		ret = 0;
+		goto exit;
+	}
 
 exit:
 	printf("%s\n", ret ? "OK" : "FAILED!");
 	sensors_config_destroy();
+	unlink("./config_test_1.bin");
+	unlink("./config_test_bin");
+	unlink("./config_test_bin.bin");
+	unlink("./config_test_reload");
 	return 0;
 }